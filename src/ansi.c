@@ -0,0 +1,280 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "ansi.h"
+
+#define SGR_MAX_PARAMS 32           /* parameters past this in a single SGR sequence are ignored */
+
+static const ansi_style plain = {ANSI_DEFAULT_COLOR, ANSI_DEFAULT_COLOR, 0};
+
+/* returns 1 if a and b render the same */
+static int same_style(const ansi_style *a, const ansi_style *b)
+{
+    return a->fg == b->fg && a->bg == b->bg && a->attrs == b->attrs;
+}
+
+/* makes style the style of the visible text from start onwards. Runs which
+ * would not change the style or would hold no text are merged away */
+static void set_run(ansi_entry *e, size_t start, const ansi_style *style)
+{
+    style_run *last = &e->runs[e->count - 1];
+    if (same_style(&last->style, style))
+        return ;
+    if (last->start == start) {
+        last->style = *style;
+        if (e->count > 1 && same_style(&e->runs[e->count - 2].style, style))
+            e->count--;
+        return ;
+    }
+    if (e->count == e->cap) {
+        unsigned int newcap = e->cap * 2;
+        style_run *newmem = realloc(e->runs, sizeof(style_run) * newcap);
+        if (newmem == NULL) {
+            free(e->runs);
+            exit(EXIT_FAILURE);
+        }
+        e->runs = newmem;
+        e->cap = newcap;
+    }
+    e->runs[e->count].start = start;
+    e->runs[e->count].style = *style;
+    e->count++;
+}
+
+/* reads a 256 color or 24 bit color following a 38 or 48 parameter into
+ * color. Returns the number of parameters used */
+static int extended_color(const int *p, int n, int *color)
+{
+    if (n >= 2 && p[0] == 5) {
+        *color = p[1] & 0xff;
+        return 2;
+    }
+    if (n >= 4 && p[0] == 2) {
+        *color = ANSI_RGB | (p[1] & 0xff) << 16 | (p[2] & 0xff) << 8 | (p[3] & 0xff);
+        return 4;
+    }
+    return n;
+}
+
+/* applies the parameters of an SGR sequence (the part between ESC[ and m) to style */
+static void apply_sgr(ansi_style *style, const char *params, size_t len)
+{
+    int p[SGR_MAX_PARAMS];
+    int n = 1;
+    size_t i = 0;
+    int k = 0;
+    p[0] = 0;
+    for(i = 0; i < len; i++) {
+        if (params[i] == ';' || params[i] == ':') {
+            if (n == SGR_MAX_PARAMS)
+                break;
+            p[n++] = 0;
+        } else if (params[i] >= '0' && params[i] <= '9' && p[n-1] < 10000) {
+            p[n-1] = p[n-1] * 10 + params[i] - '0';
+        }
+    }
+    for(k = 0; k < n; k++) {
+        int code = p[k];
+        if (code == 0)
+            *style = plain;
+        else if (code >= 1 && code <= 9)
+            style->attrs |= 1u << code;
+        else if (code == 22)
+            style->attrs &= ~(1u << 1 | 1u << 2);
+        else if (code == 25)
+            style->attrs &= ~(1u << 5 | 1u << 6);
+        else if (code >= 23 && code <= 29)
+            style->attrs &= ~(1u << (code - 20));
+        else if (code >= 30 && code <= 37)
+            style->fg = code - 30;
+        else if (code == 38)
+            k += extended_color(p + k + 1, n - k - 1, &style->fg);
+        else if (code == 39)
+            style->fg = ANSI_DEFAULT_COLOR;
+        else if (code >= 40 && code <= 47)
+            style->bg = code - 40;
+        else if (code == 48)
+            k += extended_color(p + k + 1, n - k - 1, &style->bg);
+        else if (code == 49)
+            style->bg = ANSI_DEFAULT_COLOR;
+        else if (code >= 90 && code <= 97)
+            style->fg = code - 90 + 8;
+        else if (code >= 100 && code <= 107)
+            style->bg = code - 100 + 8;
+    }
+}
+
+/* returns the length of the escape sequence at the start of s. CSI sequences
+ * end at their final byte and OSC sequences at BEL or ESC \. A sequence cut
+ * off by the end of the line takes up the rest of it */
+static size_t escape_len(const char *s, size_t len)
+{
+    size_t i = 2;
+    if (len < 2)
+        return len;
+    if (s[1] == '[') {
+        while(i < len && (s[i] < 0x40 || s[i] > 0x7e))
+            i++;
+        return i < len ? i + 1 : len;
+    }
+    if (s[1] == ']') {
+        while(i < len && s[i] != '\a' && !(s[i] == '\x1b' && i + 1 < len && s[i+1] == '\\'))
+            i++;
+        if (i == len)
+            return len;
+        return s[i] == '\a' ? i + 1 : i + 2;
+    }
+    return 2;
+}
+
+/* splits row into its visible text and style runs. Lines without escape
+ * sequences are used straight from the mapping */
+static void parse_line(frow *row, ansi_entry *e)
+{
+    const char *line = row->line;
+    size_t len = row->len;
+    size_t i = 0;
+    ansi_style style = plain;
+    if (e->runs == NULL) {
+        e->runs = malloc(sizeof(style_run) * 4);
+        if (e->runs == NULL)
+            exit(EXIT_FAILURE);
+        e->cap = 4;
+    }
+    e->runs[0].start = 0;
+    e->runs[0].style = plain;
+    e->count = 1;
+    if (memchr(line, '\x1b', len) == NULL) {
+        e->text = line;
+        e->len = len;
+        return ;
+    }
+    /* the visible text is never longer than the line */
+    if (e->buf_cap < len) {
+        char *newmem = realloc(e->buf, len);
+        if (newmem == NULL) {
+            free(e->buf);
+            exit(EXIT_FAILURE);
+        }
+        e->buf = newmem;
+        e->buf_cap = len;
+    }
+    e->len = 0;
+    while(i < len) {
+        const char *esc = memchr(line + i, '\x1b', len - i);
+        size_t plain_len = esc ? (size_t)(esc - line) - i : len - i;
+        memcpy(e->buf + e->len, line + i, plain_len);
+        e->len += plain_len;
+        i += plain_len;
+        if (esc == NULL)
+            break;
+        size_t n = escape_len(esc, len - i);
+        /* only SGR sequences (ESC [ ... m) are kept. Cursor movement and
+         * everything else would corrupt the screen and is dropped */
+        if (n >= 3 && esc[1] == '[' && esc[n-1] == 'm') {
+            apply_sgr(&style, esc + 2, n - 3);
+            set_run(e, e->len, &style);
+        }
+        i += n;
+    }
+    e->text = e->buf;
+}
+
+/* Returns the visible text and style runs of line. Lines are parsed only when
+ * they are not in the cache, so redrawing the same screen parses nothing */
+ansi_entry *ansi_line(fv_ansi *a, fv_file *f, unsigned int line)
+{
+    ansi_entry *e = &a->cache[line % ANSI_CACHE_SIZE];
+    if (!e->filled || e->line != line) {
+        parse_line(f->contents[line], e);
+        e->line = line;
+        e->filled = 1;
+        /* matches of the previous line are stale */
+        e->generation = 0;
+    }
+    return e;
+}
+
+/* Returns the matches of the current search pattern in the visible text of e.
+ * Returns NULL if there is no pattern */
+match_entry *ansi_matches(ansi_entry *e, fv_search *s)
+{
+    if (s->pattern == NULL || s->len == 0)
+        return NULL;
+    if (e->generation != s->generation) {
+        match_text(s, e->text, e->len, &e->matches);
+        e->generation = s->generation;
+    }
+    return &e->matches;
+}
+
+/* appends the SGR parameters selecting color to out. base is 30 for the
+ * foreground and 40 for the background */
+static int format_color(int color, int base, char *out)
+{
+    if (color == ANSI_DEFAULT_COLOR)
+        return 0;
+    if (color & ANSI_RGB)
+        return sprintf(out, ";%d;2;%d;%d;%d", base + 8, (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+    if (color < 8)
+        return sprintf(out, ";%d", base + color);
+    if (color < 16)
+        return sprintf(out, ";%d", base + 60 + color - 8);
+    return sprintf(out, ";%d;5;%d", base + 8, color);
+}
+
+/* Writes an SGR sequence switching from any style to style into out and
+ * returns its length. reverse adds reverse video for search matches.
+ * out must have space for ANSI_STYLE_MAX characters */
+int format_style(const ansi_style *style, int reverse, char *out)
+{
+    int len = sprintf(out, "\x1b[0");
+    int code = 0;
+    for(code = 1; code <= 9; code++) {
+        if (style->attrs & (1u << code))
+            len += sprintf(out + len, ";%d", code);
+    }
+    if (reverse)
+        len += sprintf(out + len, ";7");
+    len += format_color(style->fg, 30, out + len);
+    len += format_color(style->bg, 40, out + len);
+    out[len++] = 'm';
+    return len;
+}
+
+/* frees the parsed lines in the cache */
+void free_ansi(fv_ansi *a)
+{
+    unsigned int i = 0;
+    for(i = 0; i < ANSI_CACHE_SIZE; i++) {
+        free(a->cache[i].buf);
+        free(a->cache[i].runs);
+        free(a->cache[i].matches.starts);
+    }
+    memset(a, 0, sizeof(fv_ansi));
+}
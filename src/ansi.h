@@ -0,0 +1,76 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _ANSI_H_
+#define _ANSI_H_
+
+#include "fv_file.h"
+#include "search.h"
+
+#define ANSI_CACHE_SIZE 256     /* number of per-line entries in the parsed line cache */
+#define ANSI_DEFAULT_COLOR -1   /* terminal default foreground or background */
+#define ANSI_RGB 0x1000000      /* set in a color holding a 24 bit 0xrrggbb value */
+#define ANSI_STYLE_MAX 64       /* longest SGR sequence written by format_style() */
+
+/* graphic rendition set by SGR escape sequences */
+struct ansi_style {
+    int fg, bg;                      /* ANSI_DEFAULT_COLOR, a palette index (0-255) or ANSI_RGB | 0xrrggbb */
+    unsigned int attrs;              /* bit n is set if SGR attribute n (1-9) is on */
+};
+typedef struct ansi_style ansi_style;
+
+/* style of the visible text from start up to the start of the next run */
+struct style_run {
+    size_t start;
+    ansi_style style;
+};
+typedef struct style_run style_run;
+
+/* a line split into its visible text and the styles applied to it */
+struct ansi_entry {
+    unsigned int line;               /* line number (0 based) this entry belongs to */
+    int filled;                      /* 1 if the entry holds the parsed form of 'line' */
+    const char *text;                /* visible text. Points into the mapping if the line has no escapes */
+    size_t len;                      /* length of the visible text */
+    char *buf;                       /* visible text of a line with escapes */
+    size_t buf_cap;                  /* capacity of buf */
+    style_run *runs;                 /* style changes sorted by start. runs[0] starts at 0 */
+    unsigned int count;              /* number of runs */
+    unsigned int cap;                /* capacity of the runs array */
+    unsigned int generation;         /* search generation matches were found for */
+    match_entry matches;             /* matches of the search pattern in the visible text */
+};
+typedef struct ansi_entry ansi_entry;
+
+struct fv_ansi {
+    ansi_entry cache[ANSI_CACHE_SIZE];     /* direct mapped cache indexed by line % ANSI_CACHE_SIZE */
+};
+typedef struct fv_ansi fv_ansi;
+
+ansi_entry *ansi_line(fv_ansi *a, fv_file *f, unsigned int line);
+match_entry *ansi_matches(ansi_entry *e, fv_search *s);
+int format_style(const ansi_style *style, int reverse, char *out);
+void free_ansi(fv_ansi *a);
+
+#endif /* _ANSI_H_ */
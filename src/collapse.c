@@ -0,0 +1,77 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <stdlib.h>
+
+#include "collapse.h"
+
+/* Switches to mode. Rows are built from the line hashes, which are computed
+ * on the first switch only, so toggling again never reads the file.
+ * Returns 0 on success and -1 on failure */
+int set_collapse(fv_collapse *c, fv_file *f, enum collapse_mode mode)
+{
+    uint64_t *hashes;
+    unsigned int i = 0;
+    free_collapse(c);
+    if (mode == COLLAPSE_OFF)
+        return 0;
+    if (hash_lines(f) == -1)
+        return -1;
+    hashes = mode == COLLAPSE_MASKED ? f->masked_hashes : f->hashes;
+    c->starts = malloc(sizeof(unsigned int) * (f->line_count + 1));
+    if (c->starts == NULL)
+        return -1;
+    for(i = 0; i < f->line_count; i++) {
+        if (i == 0 || hashes[i] != hashes[i-1])
+            c->starts[c->count++] = i;
+    }
+    c->starts[c->count] = f->line_count;
+    c->mode = mode;
+    return 0;
+}
+
+/* returns the row showing line */
+unsigned int collapse_row(fv_collapse *c, unsigned int line)
+{
+    unsigned int lo = 0;
+    unsigned int hi = c->count;
+    /* last row starting at or before line */
+    while(hi - lo > 1) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (c->starts[mid] <= line)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* frees the rows and switches collapsing off */
+void free_collapse(fv_collapse *c)
+{
+    free(c->starts);
+    c->starts = NULL;
+    c->count = 0;
+    c->mode = COLLAPSE_OFF;
+}
@@ -0,0 +1,50 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _COLLAPSE_H_
+#define _COLLAPSE_H_
+
+#include "fv_file.h"
+
+/* collapse modes */
+enum collapse_mode {
+    COLLAPSE_OFF,
+    COLLAPSE_EXACT,                  /* fold runs of identical lines */
+    COLLAPSE_MASKED                  /* fold runs of lines identical after masking numbers and hex ids */
+};
+
+/* Runs of repeated lines folded into single rows. Row i shows lines
+ * starts[i] to starts[i+1] - 1 */
+struct fv_collapse {
+    enum collapse_mode mode;         /* current mode */
+    unsigned int *starts;            /* first line of every row. starts[count] is line_count */
+    unsigned int count;              /* number of rows */
+};
+typedef struct fv_collapse fv_collapse;
+
+int set_collapse(fv_collapse *c, fv_file *f, enum collapse_mode mode);
+unsigned int collapse_row(fv_collapse *c, unsigned int line);
+void free_collapse(fv_collapse *c);
+
+#endif /* _COLLAPSE_H_ */
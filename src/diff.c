@@ -0,0 +1,269 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff.h"
+
+#define DIFF_WINDOW 4096        /* lines of each file diffed at a time */
+
+/* edit script operations */
+enum diff_op {
+    OP_KEEP,
+    OP_DEL,
+    OP_INS
+};
+
+/* state of a single windowed diff */
+struct diff_ctx {
+    const uint64_t *a, *b;           /* line hashes of the window */
+    int *vf, *vb;                    /* furthest reaching paths of the forward and reverse searches */
+    char *ops;                       /* edit script, one operation per line */
+    int nops;
+};
+
+/* a snake from (x, y) to (u, v) */
+struct snake {
+    int x, y, u, v;
+};
+
+/* appends n operations op to the edit script */
+static void emit(struct diff_ctx *c, enum diff_op op, int n)
+{
+    memset(c->ops + c->nops, op, n);
+    c->nops += n;
+}
+
+/* Finds the middle snake of a[0, n) and b[0, m) as described in "An O(ND)
+ * Difference Algorithm and Its Variations" by Eugene W. Myers. The forward
+ * and reverse searches meet in the middle, so only O(n + m) space is used */
+static void middle_snake(struct diff_ctx *c, const uint64_t *a, int n, const uint64_t *b, int m, struct snake *s)
+{
+    int delta = n - m;
+    int odd = delta & 1;
+    int max = (n + m + 1) / 2;
+    int *vf = c->vf + max + 1;
+    int *vb = c->vb + max + 1;
+    int d, k;
+    vf[1] = 0;
+    vb[1] = 0;
+    for(d = 0; d <= max; d++) {
+        /* forward search */
+        for(k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && vf[k-1] < vf[k+1])) ? vf[k+1] : vf[k-1] + 1;
+            int y = x - k;
+            int x0 = x, y0 = y;
+            while(x < n && y < m && a[x] == b[y]) {
+                x++;
+                y++;
+            }
+            vf[k] = x;
+            if (odd && k >= delta - (d - 1) && k <= delta + (d - 1) && x + vb[delta - k] >= n) {
+                s->x = x0;
+                s->y = y0;
+                s->u = x;
+                s->v = y;
+                return ;
+            }
+        }
+        /* reverse search. x and y count from the end of a and b */
+        for(k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && vb[k-1] < vb[k+1])) ? vb[k+1] : vb[k-1] + 1;
+            int y = x - k;
+            int x0 = x, y0 = y;
+            while(x < n && y < m && a[n-1-x] == b[m-1-y]) {
+                x++;
+                y++;
+            }
+            vb[k] = x;
+            if (!odd && delta - k >= -d && delta - k <= d && x + vf[delta - k] >= n) {
+                s->x = n - x;
+                s->y = m - y;
+                s->u = n - x0;
+                s->v = m - y0;
+                return ;
+            }
+        }
+    }
+}
+
+/* appends the edit script of a[0, n) and b[0, m) to c->ops */
+static void diff_rec(struct diff_ctx *c, const uint64_t *a, int n, const uint64_t *b, int m)
+{
+    int prefix = 0;
+    int suffix = 0;
+    struct snake s = {0, 0, 0, 0};
+    while(prefix < n && prefix < m && a[prefix] == b[prefix])
+        prefix++;
+    emit(c, OP_KEEP, prefix);
+    a += prefix;
+    b += prefix;
+    n -= prefix;
+    m -= prefix;
+    while(suffix < n && suffix < m && a[n-1-suffix] == b[m-1-suffix])
+        suffix++;
+    n -= suffix;
+    m -= suffix;
+    if (n == 0) {
+        emit(c, OP_INS, m);
+    } else if (m == 0) {
+        emit(c, OP_DEL, n);
+    } else {
+        middle_snake(c, a, n, b, m, &s);
+        diff_rec(c, a, s.x, b, s.y);
+        emit(c, OP_KEEP, s.u - s.x);
+        diff_rec(c, a + s.u, n - s.u, b + s.v, m - s.v);
+    }
+    emit(c, OP_KEEP, suffix);
+}
+
+/* appends a row to the alignment */
+static int push_row(fv_diff *d, int a, int b)
+{
+    if (d->count == d->cap) {
+        unsigned int newcap = d->cap ? d->cap * 2 : 1024;
+        diff_row *newmem = realloc(d->rows, sizeof(diff_row) * newcap);
+        if (newmem == NULL)
+            return -1;
+        d->rows = newmem;
+        d->cap = newcap;
+    }
+    d->rows[d->count].a = a;
+    d->rows[d->count].b = b;
+    d->count++;
+    return 0;
+}
+
+/* Turns the first nops operations of an edit script into rows. Deleted and
+ * inserted lines of the same hunk are shown side by side */
+static int push_ops(fv_diff *d, const char *ops, int nops)
+{
+    int i = 0;
+    while(i < nops) {
+        if (ops[i] == OP_KEEP) {
+            if (push_row(d, d->a_done++, d->b_done++) == -1)
+                return -1;
+            i++;
+            continue;
+        }
+        int dels = 0;
+        int ins = 0;
+        int j = 0;
+        while(i < nops && ops[i] != OP_KEEP) {
+            if (ops[i] == OP_DEL)
+                dels++;
+            else
+                ins++;
+            i++;
+        }
+        for(j = 0; j < dels || j < ins; j++) {
+            if (push_row(d, j < dels ? d->a_done + j : DIFF_NONE, j < ins ? d->b_done + j : DIFF_NONE) == -1)
+                return -1;
+        }
+        d->a_done += dels;
+        d->b_done += ins;
+    }
+    return 0;
+}
+
+/* Aligns the next window of DIFF_WINDOW lines of each file. Unless the
+ * window reaches the end of both files, only the rows up to its last common
+ * line are kept, since the rest may align differently with the lines after
+ * the window. Returns 0 on success and -1 on failure */
+static int diff_window(fv_diff *d, fv_file *a, fv_file *b)
+{
+    struct diff_ctx c;
+    int n = a->line_count - d->a_done;
+    int m = b->line_count - d->b_done;
+    int last = 0;
+    int i = 0;
+    if (n > DIFF_WINDOW)
+        n = DIFF_WINDOW;
+    if (m > DIFF_WINDOW)
+        m = DIFF_WINDOW;
+    c.a = a->hashes + d->a_done;
+    c.b = b->hashes + d->b_done;
+    c.vf = malloc(sizeof(int) * (n + m + 5));
+    c.vb = malloc(sizeof(int) * (n + m + 5));
+    c.ops = malloc(n + m + 1);
+    c.nops = 0;
+    if (c.vf == NULL || c.vb == NULL || c.ops == NULL) {
+        free(c.vf);
+        free(c.vb);
+        free(c.ops);
+        return -1;
+    }
+    diff_rec(&c, c.a, n, c.b, m);
+    last = c.nops;
+    if (d->a_done + n < a->line_count || d->b_done + m < b->line_count) {
+        /* keep everything if the window has no common lines */
+        for(i = c.nops - 1; i >= 0; i--) {
+            if (c.ops[i] == OP_KEEP) {
+                last = i + 1;
+                break;
+            }
+        }
+    }
+    int ret = push_ops(d, c.ops, last);
+    free(c.vf);
+    free(c.vb);
+    free(c.ops);
+    return ret;
+}
+
+/* Aligns rows until at least 'needed' rows exist or both files are aligned
+ * to the end. Identical runs are aligned by comparing hashes directly, so
+ * equal regions of large files cost no diffing at all.
+ * Returns 0 on success and -1 on failure */
+int diff_extend(fv_diff *d, fv_file *a, fv_file *b, unsigned int needed)
+{
+    while(!d->complete && d->count < needed) {
+        /* fast path for common lines */
+        while(d->count < needed && d->a_done < a->line_count && d->b_done < b->line_count
+              && a->hashes[d->a_done] == b->hashes[d->b_done]) {
+            if (push_row(d, d->a_done, d->b_done) == -1)
+                return -1;
+            d->a_done++;
+            d->b_done++;
+        }
+        if (d->a_done == a->line_count && d->b_done == b->line_count) {
+            d->complete = 1;
+            break;
+        }
+        if (d->count >= needed)
+            break;
+        if (diff_window(d, a, b) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+/* frees the alignment */
+void free_diff(fv_diff *d)
+{
+    free(d->rows);
+    d->rows = NULL;
+    d->count = d->cap = 0;
+}
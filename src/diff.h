@@ -0,0 +1,53 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _DIFF_H_
+#define _DIFF_H_
+
+#include "fv_file.h"
+
+#define DIFF_NONE -1            /* a row with no line on one side */
+
+/* a row of the side by side diff. Lines are 0 based */
+struct diff_row {
+    int a;                           /* line of the first file. DIFF_NONE if the line was inserted */
+    int b;                           /* line of the second file. DIFF_NONE if the line was deleted */
+};
+typedef struct diff_row diff_row;
+
+/* Alignment of two files. Rows are aligned lazily, a window at a time, as
+ * the view moves down */
+struct fv_diff {
+    diff_row *rows;                  /* rows aligned so far */
+    unsigned int count;              /* number of rows aligned so far */
+    unsigned int cap;                /* capacity of the rows array */
+    unsigned int a_done, b_done;     /* lines of each file aligned so far */
+    int complete;                    /* 1 once both files are aligned to the end */
+};
+typedef struct fv_diff fv_diff;
+
+int diff_extend(fv_diff *d, fv_file *a, fv_file *b, unsigned int needed);
+void free_diff(fv_diff *d);
+
+#endif /* _DIFF_H_ */
@@ -25,10 +25,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 
 #include "draw.h"
 
 #define MAX_FILENAME_LEN 32        /* maximum length of filename in status bar */
+#define TABLE_SEP " | "            /* separator between table columns */
+#define TABLE_SEP_LEN 3
 
 /* Dynamic character buffer data structure. Multiple write()s cause a flickering effect. To avoid
  * this all the data to be written is stored in a dynamic buffer and written in one go */
@@ -89,13 +92,33 @@ static void status_bar(fv_state *state)
     struct dynbuf_char dyn = dynbuf_char_INIT;
     /* invert colors */
     dynbuf_char_insert(&dyn, "\x1b[7m", 4);
-    char status[state->tcols + 16];
-    if (state->f.filename_len > MAX_FILENAME_LEN) {
-        char *filename = state->filename + state->f.filename_len - 1 - MAX_FILENAME_LEN;
-        sprintf(status, " File: ...%*s [%d/%d]", MAX_FILENAME_LEN, filename, state->voffset + 1, state->f.line_count);
+    char status[state->tcols + 2 * MAX_FILENAME_LEN + 64];
+    if (state->diff_mode) {
+        /* show the last MAX_FILENAME_LEN characters of each name */
+        char *name1 = state->filename;
+        char *name2 = state->filename2;
+        if (state->f.filename_len > MAX_FILENAME_LEN)
+            name1 += state->f.filename_len - MAX_FILENAME_LEN;
+        if (state->f2.filename_len > MAX_FILENAME_LEN)
+            name2 += state->f2.filename_len - MAX_FILENAME_LEN;
+        sprintf(status, " Diff: %s %s [%d/%d%s]", name1, name2, state->voffset + 1, state->diff.count,
+                state->diff.complete ? "" : "+");
     } else {
-        sprintf(status, " File: %s [%d/%d]", state->filename, state->voffset + 1, state->f.line_count);
+        /* voffset is a row when collapsing. Show the line it starts at */
+        unsigned int line = state->voffset;
+        if (state->collapse.mode != COLLAPSE_OFF && line < state->collapse.count)
+            line = state->collapse.starts[line];
+        if (state->f.filename_len > MAX_FILENAME_LEN) {
+            char *filename = state->filename + state->f.filename_len - 1 - MAX_FILENAME_LEN;
+            sprintf(status, " File: ...%*s [%d/%d]", MAX_FILENAME_LEN, filename, line + 1, state->f.line_count);
+        } else {
+            sprintf(status, " File: %s [%d/%d]", state->filename, line + 1, state->f.line_count);
+        }
     }
+    if (state->panes.count > 1)
+        sprintf(status + strlen(status), " [pane %u/%u]", pane_number(&state->panes), state->panes.count);
+    if (state->show_stats)
+        sprintf(status + strlen(status), " [majflt: %ld]", state->frame_majflt);
     dynbuf_char_insert(&dyn, status, strlen(status));
     /* fill out bar with spaces */
     int i = 0;
@@ -110,49 +133,440 @@ static void status_bar(fv_state *state)
 /* draws the prompt below status bar */
 static void prompt(fv_state *state)
 {
-    if (state->prompt_idx)
+    if (state->prompt_idx) {
         write(STDOUT_FILENO, state->prompt, state->prompt_idx);
-    else
+        /* erase characters removed with backspace */
+        write(STDOUT_FILENO, "\x1b[K", 3);
+    } else if (state->message) {
+        write(STDOUT_FILENO, state->message, strlen(state->message));
+        write(STDOUT_FILENO, "\x1b[K", 3);
+    } else if (state->export.active) {
+        /* progress of the running export */
+        write(STDOUT_FILENO, state->export.status, strlen(state->export.status));
         write(STDOUT_FILENO, "\x1b[K", 3);
+    } else {
+        write(STDOUT_FILENO, "\x1b[K", 3);
+    }
     return ;
 }
 
-/* draw rows */
-void draw_rows(fv_state *state)
+/* draws len characters of line starting from start. Characters which are part
+ * of a match in m are drawn in reverse video */
+static void draw_matches(struct dynbuf_char *dyn, char *line, size_t start, size_t len, match_entry *m, size_t plen)
+{
+    size_t pos = start;
+    size_t end = start + len;
+    unsigned int k = 0;
+    for(k = 0; m != NULL && k < m->count && pos < end; k++) {
+        size_t mstart = m->starts[k];
+        size_t mend = mstart + plen;
+        if (mend <= pos)
+            continue;
+        if (mstart >= end)
+            break;
+        /* plain text before the match */
+        if (mstart > pos) {
+            dynbuf_char_insert(dyn, line + pos, mstart - pos);
+            pos = mstart;
+        }
+        if (mend > end)
+            mend = end;
+        dynbuf_char_insert(dyn, "\x1b[7m", 4);
+        dynbuf_char_insert(dyn, line + pos, mend - pos);
+        dynbuf_char_insert(dyn, "\x1b[27m", 5);
+        pos = mend;
+    }
+    if (pos < end)
+        dynbuf_char_insert(dyn, line + pos, end - pos);
+}
+
+/* "00" to "ff". Built on first use by format_hex_row() */
+static char hex_pairs[256 * 2];
+
+/* Formats the hex dump row at byte offset 'offset' into out and returns its
+ * length. Bytes are converted two hex digits at a time with a lookup table.
+ * out must have space for HEX_LINE_MAX characters */
+#define HEX_LINE_MAX 128
+static int format_hex_row(fv_file *f, size_t offset, int offdigs, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    if (hex_pairs[0] == '\0') {
+        int b = 0;
+        for(b = 0; b < 256; b++) {
+            hex_pairs[2*b] = digits[b >> 4];
+            hex_pairs[2*b + 1] = digits[b & 0xf];
+        }
+    }
+    const unsigned char *bytes = (const unsigned char *)f->map + offset;
+    size_t n = f->size - offset;
+    if (n > HEX_ROW_BYTES)
+        n = HEX_ROW_BYTES;
+    int len = sprintf(out, "%0*zx  ", offdigs, offset);
+    char *hex = out + len;
+    char *ascii = hex + HEX_ROW_BYTES * 3 + 2;
+    size_t i = 0;
+    /* pad the hex column so the ascii column stays aligned on the last row */
+    memset(hex, ' ', ascii - hex);
+    for(i = 0; i < n; i++) {
+        /* extra space between the two halves of the row */
+        char *pos = hex + 3 * i + (i >= HEX_ROW_BYTES / 2);
+        memcpy(pos, hex_pairs + 2 * bytes[i], 2);
+        ascii[i + 1] = (bytes[i] >= 0x20 && bytes[i] < 0x7f) ? bytes[i] : '.';
+    }
+    ascii[0] = '|';
+    ascii[n + 1] = '|';
+    return ascii + n + 2 - out;
+}
+
+/* moves the cursor to the start of row i of pane p and blanks the row. Rows
+ * are blanked with ECH so that panes beside p are left alone */
+static void start_pane_row(struct dynbuf_char *dyn, fv_pane *p, unsigned int i)
+{
+    char temp[48];
+    int len = sprintf(temp, "\x1b[%u;%uH\x1b[%uX", p->top + i + 1, p->left + 1, p->cols);
+    dynbuf_char_insert(dyn, temp, len);
+}
+
+/* draws a hex dump of the rows of pane p. Rows are formatted straight from
+ * the mapping, so only the bytes on screen are ever touched */
+static void draw_hex_rows(fv_state *state, struct dynbuf_char *dyn, fv_pane *p)
+{
+    unsigned int lines_drawn = 0;
+    unsigned int i = p->voffset;
+    for(lines_drawn = 0; lines_drawn < p->rows; lines_drawn++, i++) {
+        start_pane_row(dyn, p, lines_drawn);
+        if (i >= state->f.line_count)
+            continue;
+        char line[HEX_LINE_MAX];
+        int linelen = format_hex_row(&state->f, (size_t)i * HEX_ROW_BYTES, state->f.linenum_digs, line);
+        /* rows scroll horizontally so that the ascii column fits narrow panes */
+        if (p->hoffset >= (unsigned int)linelen)
+            continue;
+        linelen -= p->hoffset;
+        if (linelen > p->cols)
+            linelen = p->cols;
+        dynbuf_char_insert(dyn, line + p->hoffset, linelen);
+    }
+}
+
+/* draws n spaces */
+static void draw_padding(struct dynbuf_char *dyn, int n)
+{
+    while(n-- > 0)
+        dynbuf_char_insert(dyn, " ", 1);
+}
+
+/* draws a row of a table in at most avail columns. Columns start from the
+ * hoffset of pane p and are padded to their sampled widths. Fields wider than
+ * their column are truncated. Only the field offsets of visible rows are ever
+ * parsed */
+static void draw_table_row(fv_state *state, struct dynbuf_char *dyn, fv_pane *p, unsigned int line, int avail)
+{
+    field_entry *fields = row_fields(&state->table, &state->f, line);
+    match_entry *m = line_matches(&state->search, &state->f, line);
+    char *text = state->f.contents[line]->line;
+    unsigned int col = p->hoffset;
+    while(col < fields->count && avail > 0) {
+        int width = column_width(&state->table, col);
+        if (width > avail)
+            width = avail;
+        size_t start = fields->starts[col];
+        size_t len = fields->starts[col+1] - start - 1;
+        if (len > width)
+            len = width;
+        draw_matches(dyn, text, start, len, m, state->search.len);
+        draw_padding(dyn, width - len);
+        avail -= width;
+        if (col + 1 == fields->count || avail < TABLE_SEP_LEN)
+            break;
+        dynbuf_char_insert(dyn, TABLE_SEP, TABLE_SEP_LEN);
+        avail -= TABLE_SEP_LEN;
+        col++;
+    }
+}
+
+/* Draws the visible text of an ANSI colored line in at most avail columns
+ * starting from the hoffset of pane p. The style active there is set first, so
+ * colors carry over to lines scrolled horizontally. Matches of the search
+ * pattern are drawn in reverse video on top of the line's own style */
+static void draw_ansi_line(fv_state *state, struct dynbuf_char *dyn, fv_pane *p, unsigned int line, int avail)
+{
+    ansi_entry *e = ansi_line(&state->ansi, &state->f, line);
+    match_entry *m = ansi_matches(e, &state->search);
+    size_t plen = state->search.len;
+    size_t pos = p->hoffset;
+    size_t end = e->len;
+    unsigned int r = 0;
+    unsigned int k = 0;
+    int styled = 0;
+    char sgr[ANSI_STYLE_MAX];
+    if (pos >= end)
+        return ;
+    if (end - pos > avail)
+        end = pos + avail;
+    /* style run and first match at the left edge */
+    while(r + 1 < e->count && e->runs[r+1].start <= pos)
+        r++;
+    while(m != NULL && k < m->count && m->starts[k] + plen <= pos)
+        k++;
+    while(pos < end) {
+        ansi_style *style = &e->runs[r].style;
+        int in_match = m != NULL && k < m->count && m->starts[k] <= pos;
+        /* draw up to the next change of style or match boundary */
+        size_t next = end;
+        if (r + 1 < e->count && e->runs[r+1].start < next)
+            next = e->runs[r+1].start;
+        if (m != NULL && k < m->count) {
+            size_t bound = in_match ? m->starts[k] + plen : m->starts[k];
+            if (bound < next)
+                next = bound;
+        }
+        if (styled || in_match || style->attrs || style->fg != ANSI_DEFAULT_COLOR || style->bg != ANSI_DEFAULT_COLOR) {
+            dynbuf_char_insert(dyn, sgr, format_style(style, in_match, sgr));
+            styled = 1;
+        }
+        dynbuf_char_insert(dyn, e->text + pos, next - pos);
+        pos = next;
+        if (r + 1 < e->count && e->runs[r+1].start <= pos)
+            r++;
+        if (in_match && m->starts[k] + plen <= pos)
+            k++;
+    }
+    if (styled)
+        dynbuf_char_insert(dyn, "\x1b[0m", 4);
+}
+
+/* formats the label of a folded row, eg. " x 2,000,000 ", into out and
+ * returns its length. out must have space for 32 characters */
+static int format_fold(char *out, unsigned int repeats)
+{
+    char digits[16];
+    int ndigits = sprintf(digits, "%u", repeats);
+    int len = sprintf(out, " x ");
+    int k = 0;
+    for(k = 0; k < ndigits; k++) {
+        /* thousands separator */
+        if (k > 0 && (ndigits - k) % 3 == 0)
+            out[len++] = ',';
+        out[len++] = digits[k];
+    }
+    out[len++] = ' ';
+    return len;
+}
+
+/* draws row with its line number in pane p. Without collapsing, row is a
+ * line number. A collapsed row shows the first line of its run and the
+ * number of lines folded into it */
+static void draw_row(fv_state *state, struct dynbuf_char *dyn, fv_pane *p, unsigned int row)
 {
-    struct dynbuf_char dyn = dynbuf_char_INIT;
-    /* last 3 rows are for - padding, status bar, prompt */
-    int rows = state->trows - 3;
     frow **contents = state->f.contents;
     int linenum_padding = state->f.linenum_digs;
+    unsigned int i = row;
+    unsigned int repeats = 1;
+    char fold[32];
+    int foldlen = 0;
+    if (state->collapse.mode != COLLAPSE_OFF) {
+        i = state->collapse.starts[row];
+        repeats = state->collapse.starts[row + 1] - i;
+    }
+    /* draw line number */
+    int numlen = 1;
+    if (state->disable_linenum == 0) {
+        char num[linenum_padding + LINENUM_PAD_CHARS];
+        sprintf(num, " %*d | ", linenum_padding, i + 1);
+        numlen = strlen(num);
+        if (numlen > p->cols)
+            numlen = p->cols;
+        dynbuf_char_insert(dyn, num, numlen);
+    }
+    if (repeats > 1)
+        foldlen = format_fold(fold, repeats);
+    int avail = (int)p->cols - numlen - foldlen;
+    if (avail < 0) {
+        /* no room for the fold label in a narrow pane */
+        avail = (int)p->cols - numlen > 0 ? (int)p->cols - numlen : 0;
+        foldlen = 0;
+    }
+    if (state->table_mode) {
+        draw_table_row(state, dyn, p, i, avail);
+    } else if (state->ansi_mode) {
+        draw_ansi_line(state, dyn, p, i, avail);
+    } else if (p->hoffset < contents[i]->len){
+        /* draw a line only if it should be visible */
+        int linelen = contents[i]->len - p->hoffset;
+        if (linelen > avail)
+            linelen = avail;
+        match_entry *m = line_matches(&state->search, &state->f, i);
+        draw_matches(dyn, contents[i]->line, p->hoffset, linelen, m, state->search.len);
+    }
+    if (foldlen > 0) {
+        dynbuf_char_insert(dyn, "\x1b[7m", 4);
+        dynbuf_char_insert(dyn, fold, foldlen);
+        dynbuf_char_insert(dyn, "\x1b[27m", 5);
+    }
+}
+
+/* draws one side of a diff row in pane p in exactly width columns. Matches
+ * of the search pattern are highlighted on both sides */
+static void draw_diff_side(fv_state *state, struct dynbuf_char *dyn, fv_pane *p, fv_file *f, int line, int digs, int width)
+{
+    if (state->disable_linenum == 0) {
+        char num[digs + 2];
+        if (line == DIFF_NONE)
+            sprintf(num, "%*s ", digs, "");
+        else
+            sprintf(num, "%*d ", digs, line + 1);
+        int numlen = strlen(num);
+        if (numlen > width)
+            numlen = width;
+        dynbuf_char_insert(dyn, num, numlen);
+        width -= numlen;
+    }
+    int linelen = 0;
+    if (line != DIFF_NONE && p->hoffset < f->contents[line]->len) {
+        linelen = f->contents[line]->len - p->hoffset;
+        if (linelen > width)
+            linelen = width;
+        match_entry *m;
+        if (f == &state->f)
+            m = line_matches(&state->search, f, line);
+        else
+            m = diff_matches(&state->search, f, line);
+        draw_matches(dyn, f->contents[line]->line, p->hoffset, linelen, m, state->search.len);
+    }
+    draw_padding(dyn, width - linelen);
+}
+
+/* Draws the rows of a side by side diff in pane p. The middle column marks
+ * changed (|), deleted (<) and inserted (>) lines like diff -y. Rows are
+ * aligned only as far as the pane needs */
+static void draw_diff_rows(fv_state *state, struct dynbuf_char *dyn, fv_pane *p)
+{
+    unsigned int lines_drawn = 0;
+    unsigned int i = p->voffset;
+    int digs = state->f.linenum_digs > state->f2.linenum_digs ? state->f.linenum_digs : state->f2.linenum_digs;
+    int width = ((int)p->cols - 3) / 2;
+    if (diff_extend(&state->diff, &state->f, &state->f2, p->voffset + p->rows) == -1)
+        quit(state, "Failed to diff files", EXIT_FAILURE, 1);
+    for(lines_drawn = 0; lines_drawn < p->rows; lines_drawn++, i++) {
+        start_pane_row(dyn, p, lines_drawn);
+        if (i >= state->diff.count || width < 0)
+            continue;
+        diff_row *row = &state->diff.rows[i];
+        char *mark = " ";
+        if (row->a == DIFF_NONE)
+            mark = ">";
+        else if (row->b == DIFF_NONE)
+            mark = "<";
+        else if (state->f.hashes[row->a] != state->f2.hashes[row->b])
+            mark = "|";
+        /* changed lines are red on the left and green on the right */
+        if (*mark != ' ')
+            dynbuf_char_insert(dyn, "\x1b[31m", 5);
+        draw_diff_side(state, dyn, p, &state->f, row->a, digs, width);
+        if (*mark != ' ')
+            dynbuf_char_insert(dyn, "\x1b[39m", 5);
+        dynbuf_char_insert(dyn, " ", 1);
+        dynbuf_char_insert(dyn, mark, 1);
+        dynbuf_char_insert(dyn, " ", 1);
+        if (*mark != ' ')
+            dynbuf_char_insert(dyn, "\x1b[32m", 5);
+        draw_diff_side(state, dyn, p, &state->f2, row->b, digs, width);
+        if (*mark != ' ')
+            dynbuf_char_insert(dyn, "\x1b[39m", 5);
+    }
+}
+
+/* draws the rows of pane p. Rows past the end of the file are left blank */
+static void draw_pane(fv_state *state, struct dynbuf_char *dyn, fv_pane *p)
+{
+    if (state->f.hex) {
+        draw_hex_rows(state, dyn, p);
+        return ;
+    }
+    if (state->diff_mode) {
+        draw_diff_rows(state, dyn, p);
+        return ;
+    }
     unsigned int line_count = state->f.line_count;
     unsigned int lines_drawn = 0;
-    unsigned int i = state->voffset;
-    while(lines_drawn < rows && i < line_count) {
-        /* clear line */
-        dynbuf_char_insert(&dyn, "\x1b[K", 3);
-        /* draw line number */
-        int numlen = 1;
-        if (state->disable_linenum == 0) {
-            char num[linenum_padding + LINENUM_PAD_CHARS];
-            sprintf(num, " %*d | ", linenum_padding, i + 1);
-            numlen = strlen(num);
-            dynbuf_char_insert(&dyn, num, numlen);
-        }
-        /* draw a line only if it should be visible */
-        if (state->hoffset < contents[i]->len){
-            /* draw line */
-            int linelen = contents[i]->len - state->hoffset;
-            if (linelen > state->tcols - numlen)
-                linelen = state->tcols - numlen;
-            dynbuf_char_insert(&dyn, contents[i]->line + state->hoffset, linelen);
-        }
-        /* draw newline and carriage return */
-        dynbuf_char_insert(&dyn, "\r\n", 2);
-        i++;
+    unsigned int i = p->voffset;
+    if (state->collapse.mode != COLLAPSE_OFF)
+        line_count = state->collapse.count;
+    /* the header row of a table stays on top while scrolling. Rows below
+     * it start at voffset, so the row scrolled to is never hidden */
+    if (state->table_mode && line_count > 0 && p->rows > 0) {
+        start_pane_row(dyn, p, 0);
+        dynbuf_char_insert(dyn, "\x1b[1m", 4);
+        draw_row(state, dyn, p, 0);
+        dynbuf_char_insert(dyn, "\x1b[22m", 5);
         lines_drawn++;
+        if (i == 0)
+            i++;
+    }
+    for(; lines_drawn < p->rows; lines_drawn++, i++) {
+        start_pane_row(dyn, p, lines_drawn);
+        if (i < line_count)
+            draw_row(state, dyn, p, i);
     }
-    write(STDIN_FILENO, dyn.buf, dyn.ptr);
+}
+
+/* draws the separators between the panes in the area of node n */
+static void draw_separators(fv_panes *panes, struct dynbuf_char *dyn, int n)
+{
+    fv_pane *node = &panes->nodes[n];
+    char temp[32];
+    unsigned int k = 0;
+    if (node->split == SPLIT_NONE)
+        return ;
+    fv_pane *first = &panes->nodes[node->child[0]];
+    if (node->split == SPLIT_ROWS) {
+        dynbuf_char_insert(dyn, temp, sprintf(temp, "\x1b[%u;%uH", first->top + first->rows + 1, node->left + 1));
+        for(k = 0; k < node->cols; k++)
+            dynbuf_char_insert(dyn, "-", 1);
+    } else {
+        for(k = 0; k < node->rows; k++) {
+            dynbuf_char_insert(dyn, temp, sprintf(temp, "\x1b[%u;%uH", node->top + k + 1, first->left + first->cols + 1));
+            dynbuf_char_insert(dyn, "|", 1);
+        }
+    }
+    draw_separators(panes, dyn, node->child[0]);
+    draw_separators(panes, dyn, node->child[1]);
+}
+
+/* Draws the panes which changed since the last frame. A pane is drawn again
+ * when its offsets change or when the search pattern or collapse mode, which
+ * show in every pane, change. Other panes are left as they are on screen */
+static void draw_panes(fv_state *state)
+{
+    fv_panes *panes = &state->panes;
+    fv_pane *active = &panes->nodes[panes->active];
+    unsigned int view = state->search.generation * 4 + state->collapse.mode;
+    struct dynbuf_char dyn = dynbuf_char_INIT;
+    int n = 0;
+    /* the offsets of the active pane are the ones being scrolled */
+    active->voffset = state->voffset;
+    active->hoffset = state->hoffset;
+    /* last 3 rows are for - padding, status bar, prompt */
+    if (panes->rows != state->trows - 3 || panes->cols != state->tcols) {
+        layout_panes(panes, state->trows - 3, state->tcols);
+        dynbuf_char_insert(&dyn, "\x1b[2J", 4);
+    }
+    for(n = next_leaf(panes, -1); n != -1; n = next_leaf(panes, n)) {
+        fv_pane *p = &panes->nodes[n];
+        if (p->drawn && view == panes->drawn_view && p->drawn_voffset == p->voffset && p->drawn_hoffset == p->hoffset)
+            continue;
+        draw_pane(state, &dyn, p);
+        p->drawn = 1;
+        p->drawn_voffset = p->voffset;
+        p->drawn_hoffset = p->hoffset;
+    }
+    panes->drawn_view = view;
+    if (!panes->separators_drawn) {
+        draw_separators(panes, &dyn, 0);
+        panes->separators_drawn = 1;
+    }
+    write(STDOUT_FILENO, dyn.buf, dyn.ptr);
     dynbuf_char_free(&dyn);
 }
 
@@ -161,9 +575,12 @@ void refresh_screen(fv_state *state)
 {
     /* hide cursor */
     write(STDOUT_FILENO, "\x1b[?25h", 6);
-    /* move cursor to top left */
-    move_cursor(0, 0);
-    draw_rows(state);
+    /* count major page faults taken while drawing the rows */
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    draw_panes(state);
+    getrusage(RUSAGE_SELF, &after);
+    state->frame_majflt = after.ru_majflt - before.ru_majflt;
     /* place cursor at the (bottom - 1) row of the screen */
     move_cursor(state->trows-1, 0);
     status_bar(state);
@@ -0,0 +1,201 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/* feature test macro for fork() and waitpid() */
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "export.h"
+
+#define EXPORT_STEP_BYTES (4 << 20)    /* bytes copied per export_step(). Keys are read between steps */
+#define EXPORT_USAGE "Usage: :w <start>,<end> <file> or :| <start>,<end> <command>"
+
+/* Runs cmd with sh -c, reading from a pipe. Its output goes to /dev/null so
+ * that it does not draw over the screen. Returns the write end of the pipe,
+ * or -1 on failure */
+static int run_command(fv_export *e, const char *cmd)
+{
+    int fds[2];
+    if (pipe(fds) == -1)
+        return -1;
+    e->child = fork();
+    if (e->child == -1) {
+        e->child = 0;
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (e->child == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fds[0], STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        if (null > STDERR_FILENO)
+            close(null);
+        /* ignored signals stay ignored across exec() */
+        signal(SIGPIPE, SIG_DFL);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[0]);
+    /* commands of later exports must not hold this pipe open */
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return fds[1];
+}
+
+/* Parses the text typed after ':' and starts writing a line range in the
+ * background. cmd is one of
+ *     w <start>,<end> <file>     write lines start to end to file
+ *     | <start>,<end> <command>  pipe lines start to end to command
+ * Line numbers are 1 based and inclusive. The range is turned into byte
+ * offsets with the line index, so the file is never re-read to find it.
+ * Returns 0 on success. On failure returns -1 and the reason is in e->status */
+int start_export(fv_export *e, fv_file *f, char *cmd, size_t len)
+{
+    char buf[len + 1];
+    char *pos;
+    unsigned long first, last;
+    reap_export(e);
+    if (e->active || e->child != 0) {
+        snprintf(e->status, EXPORT_STATUS_LEN, "An export is already running");
+        return -1;
+    }
+    memcpy(buf, cmd, len);
+    buf[len] = '\0';
+    if (len == 0 || (buf[0] != 'w' && buf[0] != '|')) {
+        snprintf(e->status, EXPORT_STATUS_LEN, EXPORT_USAGE);
+        return -1;
+    }
+    first = strtoul(buf + 1, &pos, 10);
+    if (*pos != ',') {
+        snprintf(e->status, EXPORT_STATUS_LEN, EXPORT_USAGE);
+        return -1;
+    }
+    last = strtoul(pos + 1, &pos, 10);
+    while(*pos == ' ')
+        pos++;
+    if (*pos == '\0') {
+        snprintf(e->status, EXPORT_STATUS_LEN, EXPORT_USAGE);
+        return -1;
+    }
+    if (first < 1 || first > last || first > f->line_count) {
+        snprintf(e->status, EXPORT_STATUS_LEN, "Invalid line range %lu,%lu", first, last);
+        return -1;
+    }
+    if (last > f->line_count)
+        last = f->line_count;
+
+    if (buf[0] == 'w') {
+        struct stat in, out;
+        /* the file is truncated only once it is known not to be the one shown */
+        e->out_fd = open(pos, O_WRONLY | O_CREAT, 0644);
+        if (e->out_fd == -1) {
+            snprintf(e->status, EXPORT_STATUS_LEN, "Failed to open %.64s. open() failed.", pos);
+            return -1;
+        }
+        if (fstat(f->fd, &in) == 0 && fstat(e->out_fd, &out) == 0
+            && in.st_dev == out.st_dev && in.st_ino == out.st_ino) {
+            close(e->out_fd);
+            snprintf(e->status, EXPORT_STATUS_LEN, "Can not export to the file being viewed");
+            return -1;
+        }
+        if (ftruncate(e->out_fd, 0) == -1) {
+            close(e->out_fd);
+            snprintf(e->status, EXPORT_STATUS_LEN, "Failed to truncate %.64s", pos);
+            return -1;
+        }
+    } else {
+        e->out_fd = run_command(e, pos);
+        if (e->out_fd == -1) {
+            snprintf(e->status, EXPORT_STATUS_LEN, "Failed to run %.64s. fork() failed.", pos);
+            return -1;
+        }
+        /* a command that exits early must not kill fv */
+        signal(SIGPIPE, SIG_IGN);
+        /* a slow command must not block scrolling */
+        fcntl(e->out_fd, F_SETFL, fcntl(e->out_fd, F_GETFL) | O_NONBLOCK);
+    }
+    e->start = e->off = line_offset(f, first - 1);
+    e->end = line_offset(f, last);
+    e->lines = last - first + 1;
+    e->active = 1;
+    snprintf(e->status, EXPORT_STATUS_LEN, "Exporting %u lines: 0%%", e->lines);
+    return 0;
+}
+
+/* Closes the output of an export. The command of a pipe export sees the end
+ * of its input and is reaped later by reap_export(), so a slow command never
+ * blocks scrolling */
+void stop_export(fv_export *e)
+{
+    if (!e->active)
+        return ;
+    close(e->out_fd);
+    e->active = 0;
+}
+
+/* reaps the command of a finished pipe export if it has exited */
+void reap_export(fv_export *e)
+{
+    if (e->child != 0 && waitpid(e->child, NULL, WNOHANG) != 0)
+        e->child = 0;
+}
+
+/* Copies the next EXPORT_STEP_BYTES of a running export and updates the
+ * progress in e->status. Called from the input loop whenever no key is
+ * pressed, so an export never blocks scrolling */
+void export_step(fv_export *e, fv_file *f)
+{
+    off_t stop = e->off + EXPORT_STEP_BYTES;
+    if (stop > e->end)
+        stop = e->end;
+    while(e->off < stop) {
+        ssize_t n = copy_range(f->fd, &e->off, stop - e->off, e->out_fd);
+        /* the pipe is full. Try again on the next step */
+        if (n == -1 && errno == EAGAIN)
+            break;
+        if (n <= 0) {
+            stop_export(e);
+            snprintf(e->status, EXPORT_STATUS_LEN, "Export failed: %s", n == 0 ? "unexpected end of file" : strerror(errno));
+            return ;
+        }
+    }
+    if (e->off == e->end) {
+        stop_export(e);
+        snprintf(e->status, EXPORT_STATUS_LEN, "Exported %u lines", e->lines);
+        return ;
+    }
+    snprintf(e->status, EXPORT_STATUS_LEN, "Exporting %u lines: %d%%", e->lines,
+             (int)((e->off - e->start) * 100 / (e->end - e->start)));
+}
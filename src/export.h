@@ -0,0 +1,48 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include "fv_file.h"
+
+#define EXPORT_STATUS_LEN 128   /* size of the export status message */
+
+/* a line range being written to a file or a pipe in the background */
+struct fv_export {
+    int active;                      /* 1 while an export is running */
+    int out_fd;                      /* file descriptor written to */
+    pid_t child;                     /* command of a pipe export until it is reaped. 0 if there is none */
+    off_t start, off, end;           /* byte range being exported and the next byte to copy */
+    unsigned int lines;              /* number of lines in the range */
+    char status[EXPORT_STATUS_LEN];  /* progress or result message shown in the prompt area */
+};
+typedef struct fv_export fv_export;
+
+int start_export(fv_export *e, fv_file *f, char *cmd, size_t len);
+void export_step(fv_export *e, fv_file *f);
+void stop_export(fv_export *e);
+void reap_export(fv_export *e);
+
+#endif /* _EXPORT_H_ */
@@ -54,6 +54,13 @@ int main(int argc, char *argv[])
 {
     /* initialize fv */
     parse_args(argc, argv);
+    /* act like cat when output is not a terminal. A diff has no such output */
+    if (!isatty(STDOUT_FILENO) && state.diff_mode) {
+        fprintf(stderr, "-d needs a terminal. Use diff(1) to write a diff\n");
+        return EXIT_FAILURE;
+    }
+    if (!isatty(STDOUT_FILENO))
+        return stream_file(state.filename, state.voffset, STDOUT_FILENO) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     init_fv(&state);
     prepare_terminal(&state);
     clear_screen();
@@ -68,16 +75,42 @@ int main(int argc, char *argv[])
 static void parse_args(int argc, char *argv[])
 {
     int opt;
-    while((opt = getopt(argc, argv, "lhv")) != -1) {
+    while((opt = getopt(argc, argv, "lxcdRshv")) != -1) {
         switch(opt) {
             case 'l':
                 /* disable line numbering */
                 state.disable_linenum = 1;
                 break;
 
+            case 'x':
+                /* show the file as a hex dump */
+                state.hex_mode = 1;
+                break;
+
+            case 'c':
+                /* show the file as a table */
+                state.table_mode = 1;
+                break;
+
+            case 'd':
+                /* diff two files */
+                state.diff_mode = 1;
+                break;
+
+            case 'R':
+                /* show ANSI colors instead of raw escape sequences */
+                state.ansi_mode = 1;
+                break;
+
+            case 's':
+                /* show page fault statistics */
+                state.show_stats = 1;
+                break;
+
             case 'h':
                 /* print help string and exit */
-                printf("Usage: fv <filename>[:line-number] [-l] [-h] [-v]\n");
+                printf("Usage: fv <filename>[:line-number] [-l] [-x] [-c] [-R] [-s] [-h] [-v]\n"
+                       "       fv -d <filename> <filename>\n");
                 quit(&state, NULL, EXIT_SUCCESS, 0);
 
             case 'v':
@@ -89,6 +122,14 @@ static void parse_args(int argc, char *argv[])
                 quit(&state, NULL, EXIT_SUCCESS, 0);
         }
     }
+    /* the second file of a diff is the last argument */
+    if (state.diff_mode) {
+        if (argc - optind != 2) {
+            printf("-d needs two filenames. See fv -h for usage\n");
+            exit(EXIT_FAILURE);
+        }
+        state.filename2 = argv[optind + 1];
+    }
     if (optind < argc) {
         char *seperator = strchr(argv[optind], ':');
         if (seperator == NULL) {
@@ -126,11 +167,29 @@ static void init_fv()
     /* obtain window size */
     get_window_size();
     /* read file contents */
-    if (handle_file(state.filename, &state.f) == -1)
+    if (handle_file(state.filename, &state.f, state.hex_mode) == -1)
         quit(&state, "", EXIT_FAILURE, 1);
+    if (state.diff_mode) {
+        if (handle_file(state.filename2, &state.f2, 0) == -1)
+            quit(&state, "", EXIT_FAILURE, 1);
+        if (state.f.hex || state.f2.hex)
+            quit(&state, "Binary files can not be diffed", EXIT_FAILURE, 1);
+        if (hash_lines(&state.f) == -1 || hash_lines(&state.f2) == -1)
+            quit(&state, "Failed to hash lines", EXIT_FAILURE, 1);
+        state.table_mode = 0;
+    }
+    /* .csv and .tsv files are shown as tables. Hex dumps have no fields */
+    if (is_table_file(state.filename) && !state.diff_mode)
+        state.table_mode = 1;
+    if (state.f.hex)
+        state.table_mode = 0;
+    if (state.table_mode && init_table(&state.table, &state.f) == -1)
+        quit(&state, "Failed to read table columns", EXIT_FAILURE, 1);
     /* check if voffset given by user to valid */
     if (state.voffset > state.f.line_count)
         state.voffset = 0;
+    state.search.current = -1;
+    init_panes(&state.panes);
     /* initial prompt */
     state.prompt = malloc(state.tcols);
     memset(state.prompt, '\0', state.tcols);
@@ -188,13 +247,14 @@ static int restore_terminal()
  */
 void quit(fv_state *state, char *msg, int exit_code, int switch_back)
 {
-    if (state->f.contents != NULL) {
-        int i = 0;
-        for(i = 0; i < state->f.line_count; i++) {
-            free(state->f.contents[i]->line);
-            free(state->f.contents[i]);
-        }
-    }
+    stop_export(&state->export);
+    close_file(&state->f);
+    close_file(&state->f2);
+    free_diff(&state->diff);
+    free_collapse(&state->collapse);
+    free_ansi(&state->ansi);
+    free_search(&state->search);
+    free_table(&state->table);
 
     /* restore terminal */
     if (switch_back) {
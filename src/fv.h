@@ -27,25 +27,62 @@
 
 #include <termios.h>
 #include "fv_file.h"
+#include "search.h"
+#include "table.h"
+#include "prefetch.h"
+#include "export.h"
+#include "diff.h"
+#include "collapse.h"
+#include "ansi.h"
+#include "pane.h"
 
 /* This struct contains all the state information at one place */
 struct fv_state {
     /* Terminal variables */
     struct termios orig;              /* termios struct before going into raw mode */
     unsigned int trows, tcols;        /* rows and columns of the terminal screen */
-    unsigned int voffset;             /* vertical offset. Used in vertical scrolling */
-    unsigned int hoffset;             /* horizontal offset. Used in horizontal scrolling */
+    unsigned int voffset;             /* vertical offset of the active pane. Used in vertical scrolling */
+    unsigned int hoffset;             /* horizontal offset of the active pane. Used in horizontal scrolling */
+    fv_panes panes;                   /* panes the screen is split into. see src/pane.h */
 
     /* File variables */
     char *filename;
     struct fv_file f;        /* pointer to the file struct. see src/file.h */
+    fv_prefetch readahead;            /* scroll tracking for prefetching. see src/prefetch.h */
+
+    /* Diff variables. voffset is a row of the alignment in diff mode */
+    char *filename2;                  /* second file of a diff */
+    struct fv_file f2;                /* second file of a diff */
+    fv_diff diff;                     /* alignment of f and f2. see src/diff.h */
 
     /* user options */
     int disable_linenum;
+    int hex_mode;                     /* show the file as a hex dump */
+    int table_mode;                   /* show the file as a table of delimited fields */
+    int diff_mode;                    /* show a side by side diff of filename and filename2 */
+    int ansi_mode;                    /* interpret ANSI color escape sequences */
+    int show_stats;                   /* show major page faults per frame in the status bar */
+    long frame_majflt;                /* major page faults while drawing the last frame */
+
+    /* Collapse variables. voffset is a row of folded lines when collapsing */
+    fv_collapse collapse;             /* runs of repeated lines. see src/collapse.h */
+
+    /* Table mode variables. hoffset is a column index in table mode */
+    fv_table table;                   /* delimiter, column widths and field offsets. see src/table.h */
+
+    /* ANSI mode variables. hoffset counts visible columns in ANSI mode */
+    fv_ansi ansi;                     /* visible text and styles of parsed lines. see src/ansi.h */
+
+    /* Search variables */
+    fv_search search;                 /* current pattern and match cache. see src/search.h */
+
+    /* Export variables */
+    fv_export export;                 /* line range being written in the background. see src/export.h */
 
     /* Input prompt variables */
     char *prompt;                     /* prompt below status bar */
     unsigned int prompt_idx;          /* index of the next character in prompt */
+    const char *message;              /* message shown in place of an empty prompt */
 };
 typedef struct fv_state fv_state;
 
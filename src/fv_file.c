@@ -22,21 +22,42 @@
    SOFTWARE.
 */
 
-/* feature test macros for getline() */
+/* feature test macros */
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE
 #define _GNU_SOURCE
 
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 
 #include "fv_file.h"
 #include "fv.h"
 
+/* number of bytes copied per syscall by copy_range() */
+#define COPY_CHUNK_SIZE (1 << 20)
+
+/* lines are hashed by up to HASH_MAX_THREADS threads, each taking at least
+ * HASH_MIN_LINES lines */
+#define HASH_MAX_THREADS 8
+#define HASH_MIN_LINES (1 << 16)
+
 /* number of new rows allocated when filerow dynamic array expands */
 #define FROW_BLOCK_SIZE 64
 
+/* size of the block at the start of the file used to detect binary files */
+#define DETECT_BLOCK_SIZE 4096
+/* a file is treated as binary if more than 1 / BINARY_NUL_RATIO of the
+ * detection block are NUL bytes */
+#define BINARY_NUL_RATIO 64
+
 /* counts the number of digits in n */
 static int count_digs(int n)
 {
@@ -65,7 +86,7 @@ static int verfiy_file(char *filename)
 static void insert_row(struct fv_file *f, frow *row)
 {
     if (f->line_count == f->contents_cap) {
-        struct frow **newmem = realloc(f->contents, sizeof(struct filerow*) * (f->contents_cap + FROW_BLOCK_SIZE));
+        struct frow **newmem = realloc(f->contents, sizeof(struct frow*) * (f->contents_cap + FROW_BLOCK_SIZE));
         if (newmem == NULL) {
             /* realloc failed */
             free(f->contents);
@@ -79,37 +100,178 @@ static void insert_row(struct fv_file *f, frow *row)
     return ;
 }
 
-/* Reads file and stores the lines read in the dynamic array 'contents' */
-static int read_file(FILE *fptr, fv_file *f)
+/* Returns 1 if the first block of the file looks like binary data */
+static int is_binary(fv_file *f)
 {
-    char *line = NULL;
-    size_t linelen = 0;
-    size_t linecap = 0;
+    size_t len = f->size < DETECT_BLOCK_SIZE ? f->size : DETECT_BLOCK_SIZE;
+    size_t nuls = 0;
+    size_t i = 0;
+    for(i = 0; i < len; i++) {
+        if (f->map[i] == '\0')
+            nuls++;
+    }
+    return nuls * BINARY_NUL_RATIO > len;
+}
+
+/* Splits the mapping into lines and stores them in the dynamic array 'contents'.
+ * Rows point into the mapping, so no line is copied */
+static int index_lines(fv_file *f)
+{
+    char *pos = f->map;
+    char *end = f->map + f->size;
     size_t max_linelen = 0;
-    while((linelen = getline(&line, &linecap, fptr)) != -1) {
-        while(linelen > 0 && (line[linelen-1] == '\n' || line[linelen-1] == '\r'))
+    f->contents = malloc(sizeof(struct frow *) * FROW_BLOCK_SIZE);
+    if (f->contents == NULL)
+        return -1;
+    f->contents_cap = FROW_BLOCK_SIZE;
+    while(pos < end) {
+        char *newline = memchr(pos, '\n', end - pos);
+        char *next = newline ? newline + 1 : end;
+        size_t linelen = next - pos;
+        while(linelen > 0 && (pos[linelen-1] == '\n' || pos[linelen-1] == '\r'))
             linelen--;
         struct frow *row = malloc(sizeof(struct frow));
-        row->line = malloc(linelen + 1);
-        memcpy(row->line, line, linelen);
-        row->line[linelen] = '\0';
-        row->len = linelen + 1;
+        row->line = pos;
+        row->len = linelen;
         insert_row(f, row);
         if (linelen > max_linelen)
             max_linelen = linelen;
+        pos = next;
     }
     f->max_linelen = max_linelen;
     f->linenum_digs = count_digs(f->line_count);
-    free(line);
     return 0;
 }
 
-/* If filename exists, it attempts to read file and fill out the struct fv_file
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define IS_HEX(ch) ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F'))
+
+/* adds the run of hex digits run[0, len) to the masked hash h. Runs with a
+ * decimal digit in them are numbers or ids and hash as a single '#' */
+static uint64_t hash_run(uint64_t h, const char *run, size_t len, int has_digit)
+{
+    size_t i = 0;
+    if (has_digit)
+        return (h ^ '#') * FNV_PRIME;
+    for(i = 0; i < len; i++)
+        h = (h ^ (unsigned char)run[i]) * FNV_PRIME;
+    return h;
+}
+
+/* Computes the 64 bit FNV-1a hash of a line into *exact and the hash of the
+ * line with its numbers and hex ids masked into *masked. Lines that differ
+ * only in timestamps, counters or addresses have the same masked hash */
+static void hash_line(const char *line, size_t len, uint64_t *exact, uint64_t *masked)
+{
+    uint64_t h = FNV_OFFSET;
+    uint64_t m = FNV_OFFSET;
+    size_t run = 0;
+    int in_run = 0;
+    int has_digit = 0;
+    size_t i = 0;
+    for(i = 0; i < len; i++) {
+        char ch = line[i];
+        h = (h ^ (unsigned char)ch) * FNV_PRIME;
+        if (IS_HEX(ch)) {
+            if (!in_run) {
+                in_run = 1;
+                run = i;
+                has_digit = 0;
+            }
+            if (ch >= '0' && ch <= '9')
+                has_digit = 1;
+            continue;
+        }
+        if (in_run)
+            m = hash_run(m, line + run, i - run, has_digit);
+        in_run = 0;
+        m = (m ^ (unsigned char)ch) * FNV_PRIME;
+    }
+    if (in_run)
+        m = hash_run(m, line + run, len - run, has_digit);
+    *exact = h;
+    *masked = m;
+}
+
+/* lines [first, last) hashed by a single thread */
+struct hash_job {
+    fv_file *f;
+    unsigned int first, last;
+};
+
+static void *hash_worker(void *arg)
+{
+    struct hash_job *job = arg;
+    unsigned int i = 0;
+    for(i = job->first; i < job->last; i++)
+        hash_line(job->f->contents[i]->line, job->f->contents[i]->len, &job->f->hashes[i], &job->f->masked_hashes[i]);
+    return NULL;
+}
+
+/* Hashes every line into f->hashes and f->masked_hashes. Only diffs and
+ * collapsing need the hashes, so they are computed the first time either is
+ * used instead of on every open. Lines are split into contiguous ranges
+ * hashed in parallel. Returns 0 on success and -1 on failure */
+int hash_lines(fv_file *f)
+{
+    struct hash_job jobs[HASH_MAX_THREADS];
+    pthread_t threads[HASH_MAX_THREADS];
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int per_thread;
+    int i = 0;
+    if (f->hashes != NULL)
+        return 0;
+    if (f->hex)
+        return -1;
+    f->hashes = malloc(sizeof(uint64_t) * (f->line_count + 1));
+    f->masked_hashes = malloc(sizeof(uint64_t) * (f->line_count + 1));
+    if (f->hashes == NULL || f->masked_hashes == NULL) {
+        free(f->hashes);
+        free(f->masked_hashes);
+        f->hashes = NULL;
+        f->masked_hashes = NULL;
+        return -1;
+    }
+    if (nthreads > HASH_MAX_THREADS)
+        nthreads = HASH_MAX_THREADS;
+    if (nthreads > f->line_count / HASH_MIN_LINES)
+        nthreads = f->line_count / HASH_MIN_LINES;
+    if (nthreads < 1)
+        nthreads = 1;
+    per_thread = (f->line_count + nthreads - 1) / nthreads;
+    for(i = 0; i < nthreads; i++) {
+        jobs[i].f = f;
+        jobs[i].first = i * per_thread;
+        jobs[i].last = jobs[i].first + per_thread;
+        if (jobs[i].last > f->line_count)
+            jobs[i].last = f->line_count;
+    }
+    /* the calling thread takes the first range */
+    for(i = 1; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, hash_worker, &jobs[i]) != 0) {
+            /* hash the range here if a thread can not be started */
+            hash_worker(&jobs[i]);
+            jobs[i].f = NULL;
+        }
+    }
+    hash_worker(&jobs[0]);
+    for(i = 1; i < nthreads; i++) {
+        if (jobs[i].f != NULL)
+            pthread_join(threads[i], NULL);
+    }
+    return 0;
+}
+
+/* If filename exists, it maps the file and fills out the struct fv_file.
+ * Text files are split into lines. Binary files (or any file if hex is 1)
+ * are shown as a hex dump, which needs no line index at all.
  * Returns 0 on success and -1 on failure.
  * filename -> name of the file to read.
  * *f -> pointer to fv_file struct.
+ * hex -> 1 to force hex mode. 0 to detect binary files.
  */
-int handle_file(char *filename, fv_file *f)
+int handle_file(char *filename, fv_file *f, int hex)
 {
     if (f == NULL)
         return -1;
@@ -120,21 +282,164 @@ int handle_file(char *filename, fv_file *f)
         return -1;
     }
     /* try to open the file */
-    FILE *fptr = fopen(filename, "r");
-    if(fptr == NULL) {
-        fprintf(stderr, "Failed to open %s. fopen() failed.\n", filename);
+    f->fd = open(filename, O_RDONLY);
+    if(f->fd == -1) {
+        fprintf(stderr, "Failed to open %s. open() failed.\n", filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(f->fd, &st) == -1) {
+        fprintf(stderr, "Failed to read file %s\n", filename);
         return -1;
     }
     f->filename_len = strlen(filename);
-    /* initialise contents array */
-    f->contents = malloc(sizeof(struct filerow * ) * FROW_BLOCK_SIZE);
-    f->contents_cap = FROW_BLOCK_SIZE;
+    f->size = st.st_size;
     f->line_count = 0;
-    if(read_file(fptr, f) == -1) {
-        fclose(fptr);
+    /* mmap() fails for empty files. They are shown as a file with no lines */
+    if (f->size > 0) {
+        f->map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, f->fd, 0);
+        if (f->map == MAP_FAILED) {
+            f->map = NULL;
+            fprintf(stderr, "Failed to map file %s. mmap() failed.\n", filename);
+            return -1;
+        }
+    }
+    f->hex = hex || (f->size > 0 && is_binary(f));
+    if (f->hex) {
+        /* rows are counted in an unsigned int */
+        if ((f->size + HEX_ROW_BYTES - 1) / HEX_ROW_BYTES > UINT_MAX) {
+            fprintf(stderr, "%s is too large for a hex dump.\n", filename);
+            return -1;
+        }
+        f->line_count = (f->size + HEX_ROW_BYTES - 1) / HEX_ROW_BYTES;
+        /* offsets take the place of line numbers. They are at least 8 hex digits wide */
+        f->linenum_digs = 8;
+        while(f->linenum_digs < 16 && (f->size >> (f->linenum_digs * 4)) != 0)
+            f->linenum_digs++;
+        f->max_linelen = f->linenum_digs + HEX_ROW_WIDTH;
+        return 0;
+    }
+    /* the whole file is read once from start to end while indexing */
+    if (f->map != NULL)
+        madvise(f->map, f->size, MADV_SEQUENTIAL);
+    if(index_lines(f) == -1) {
         fprintf(stderr, "Failed to read file %s\n", filename);
         return -1;
     }
-    fclose(fptr);
+    if (f->map != NULL)
+        madvise(f->map, f->size, MADV_NORMAL);
     return 0;
 }
+
+/* returns the byte offset of the start of line. The size of the file is
+ * returned for lines past the end */
+size_t line_offset(fv_file *f, unsigned int line)
+{
+    if (line >= f->line_count)
+        return f->size;
+    if (f->hex)
+        return (size_t)line * HEX_ROW_BYTES;
+    return f->contents[line]->line - f->map;
+}
+
+/* frees the line index and unmaps the file */
+void close_file(fv_file *f)
+{
+    if (f->contents != NULL) {
+        unsigned int i = 0;
+        for(i = 0; i < f->line_count; i++)
+            free(f->contents[i]);
+        free(f->contents);
+        f->contents = NULL;
+    }
+    free(f->hashes);
+    free(f->masked_hashes);
+    f->hashes = NULL;
+    f->masked_hashes = NULL;
+    if (f->map != NULL)
+        munmap(f->map, f->size);
+    f->map = NULL;
+    /* fd is 0 until the file is opened */
+    if (f->fd > 0)
+        close(f->fd);
+    f->fd = 0;
+}
+
+/* Copies at most len bytes starting at *off of in_fd to out_fd without
+ * copying them through userspace. copy_file_range() only works between
+ * regular files and sendfile() only from a file, so both are tried before
+ * falling back to read() and write(). *off is advanced past the bytes copied.
+ * Returns the number of bytes copied, 0 at end of file and -1 on failure */
+ssize_t copy_range(int in_fd, off_t *off, size_t len, int out_fd)
+{
+    ssize_t n;
+    if (len > COPY_CHUNK_SIZE)
+        len = COPY_CHUNK_SIZE;
+    n = copy_file_range(in_fd, off, out_fd, NULL, len, 0);
+    if (n >= 0)
+        return n;
+    if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EBADF && errno != EOPNOTSUPP)
+        return -1;
+    n = sendfile(out_fd, in_fd, off, len);
+    if (n >= 0)
+        return n;
+    if (errno != EINVAL && errno != ENOSYS)
+        return -1;
+    char buf[BUFSIZ];
+    if (len > sizeof(buf))
+        len = sizeof(buf);
+    n = pread(in_fd, buf, len, *off);
+    if (n <= 0)
+        return n;
+    n = write(out_fd, buf, n);
+    if (n > 0)
+        *off += n;
+    return n;
+}
+
+/* Writes filename from line number (0 based) first_line to the end to out_fd
+ * like cat. Neither a line index nor the terminal is set up, and the bytes
+ * are copied in the kernel. Returns 0 on success and -1 on failure */
+int stream_file(char *filename, unsigned int first_line, int out_fd)
+{
+    struct stat st;
+    off_t off = 0;
+    ssize_t n;
+    if (verfiy_file(filename) == -1) {
+        fprintf(stderr, "File %s not found.\n", filename);
+        return -1;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to open %s. open() failed.\n", filename);
+        return -1;
+    }
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        fprintf(stderr, "Failed to read file %s\n", filename);
+        return -1;
+    }
+    /* skip to the start of first_line */
+    if (first_line > 0 && st.st_size > 0) {
+        char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            fprintf(stderr, "Failed to map file %s. mmap() failed.\n", filename);
+            return -1;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        char *pos = map;
+        char *end = map + st.st_size;
+        while(first_line > 0 && pos < end) {
+            char *newline = memchr(pos, '\n', end - pos);
+            pos = newline ? newline + 1 : end;
+            first_line--;
+        }
+        off = pos - map;
+        munmap(map, st.st_size);
+    }
+    while(off < st.st_size && (n = copy_range(fd, &off, st.st_size - off, out_fd)) > 0)
+        ;
+    close(fd);
+    return off < st.st_size ? -1 : 0;
+}
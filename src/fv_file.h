@@ -27,25 +27,40 @@
 
 #define _GNU_SOURCE
 #include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #define LINENUM_PAD_CHARS 4     /* padding characters around line number */
+#define HEX_ROW_BYTES 16        /* bytes shown in a hex dump row */
+#define HEX_ROW_WIDTH (HEX_ROW_BYTES * 4 + 6)  /* width of a hex dump row after the offset */
 
 struct frow {
-    char *line;
-    size_t len;
+    char *line;                          /* pointer to the start of the line in the mapping */
+    size_t len;                          /* length of the line without the line terminator */
 };
 typedef struct frow frow;
 
 struct fv_file {
     unsigned int filename_len;           /* strlen() of the filename */
-    unsigned int line_count;             /* total number of lines in the file */
-    unsigned int linenum_digs;           /* number of digits in line count */
+    int fd;                              /* file descriptor of the open file */
+    char *map;                           /* read only mapping of the whole file. NULL if the file is empty */
+    size_t size;                         /* size of the file in bytes */
+    int hex;                             /* 1 if the file is shown as a hex dump */
+    unsigned int line_count;             /* total number of lines in the file. rows of HEX_ROW_BYTES in hex mode */
+    unsigned int linenum_digs;           /* number of digits in line count. digits of the offsets in hex mode */
     unsigned int max_linelen;            /* maximum width of all the lines in the file */
-    frow **contents;                     /* dynamic array of filerows */
+    frow **contents;                     /* dynamic array of filerows. NULL in hex mode */
     unsigned int contents_cap;           /* current capacity of the contents array */
+    uint64_t *hashes;                    /* hash of every line. NULL until hash_lines() is called */
+    uint64_t *masked_hashes;             /* hash of every line with numbers and hex ids masked */
 };
 typedef struct fv_file fv_file;
 
-int handle_file(char *filename, fv_file *f);
+int handle_file(char *filename, fv_file *f, int hex);
+int hash_lines(fv_file *f);
+void close_file(fv_file *f);
+size_t line_offset(fv_file *f, unsigned int line);
+ssize_t copy_range(int in_fd, off_t *off, size_t len, int out_fd);
+int stream_file(char *filename, unsigned int first_line, int out_fd);
 
 #endif /* _FV_H_ */
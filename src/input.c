@@ -22,12 +22,24 @@
    SOFTWARE.
 */
 
+/* feature test macro for poll() */
+#define _DEFAULT_SOURCE
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
 
 #include "input.h"
+#include "timestamp.h"
+
+/* returned by read_key() when no key was pressed but the screen needs a redraw */
+#define KEY_NONE 0
+
+/* prefix of the pane commands */
+#define CTRL_W 0x17
 
 /* macro to check if a char is numeric */
 #define IS_NUM(ch) (ch >= '0' && ch <= '9')
@@ -42,18 +54,37 @@ enum scroll_dir {
 
 /* Waits for user to enter a key and returns it. It handles read timeout
  * and errors. Returns the key pressed on success and -1 on failure.
+ * While an export is running, it is copied whenever its output is ready and
+ * no key is pressed. KEY_NONE is returned after every step to redraw the
+ * progress.
  */
-static int read_key()
+static int read_key(fv_state *state)
 {
     char c;
     int br;
-    while((br = read(STDIN_FILENO, &c, 1)) != 1) {
+    while(1) {
+        reap_export(&state->export);
+        if (state->export.active) {
+            struct pollfd fds[2] = {
+                {STDIN_FILENO, POLLIN, 0},
+                {state->export.out_fd, POLLOUT, 0}
+            };
+            poll(fds, 2, -1);
+            if (!(fds[0].revents & POLLIN)) {
+                export_step(&state->export, &state->f);
+                /* show the result once the export is done */
+                if (!state->export.active)
+                    state->message = state->export.status;
+                return KEY_NONE;
+            }
+        }
+        if ((br = read(STDIN_FILENO, &c, 1)) == 1)
+            return c;
         if (br == -1 && errno != EAGAIN) {
             /* If any error other than timeout occurs, return -1 */
             return -1;
         }
     }
-    return c;
 }
 
 /* converts a string of digits to a number. If the string is invalid
@@ -79,13 +110,84 @@ static void clear_prompt(fv_state *state)
     state->prompt_idx = 0;
 }
 
-/* adjusts voffset and hoffset to scroll file */
+/* Returns the number of rows that can be scrolled through. In diff mode rows
+ * are aligned lazily, so rows up to 'needed' are aligned first */
+static unsigned int row_count(fv_state *state, unsigned int needed)
+{
+    if (state->diff_mode) {
+        if (diff_extend(&state->diff, &state->f, &state->f2, needed) == -1)
+            quit(state, "Failed to diff files", EXIT_FAILURE, 1);
+        return state->diff.count;
+    }
+    if (state->collapse.mode != COLLAPSE_OFF)
+        return state->collapse.count;
+    return state->f.line_count;
+}
+
+/* returns the first line shown by row. In diff mode this is the line of the
+ * first file shown by row, or by the first row after it if it is an
+ * inserted line */
+static unsigned int row_line(fv_state *state, unsigned int row)
+{
+    if (state->diff_mode) {
+        fv_diff *d = &state->diff;
+        for(; row < d->count; row++) {
+            if (d->rows[row].a != DIFF_NONE)
+                return d->rows[row].a;
+        }
+        return d->a_done;
+    }
+    if (state->collapse.mode != COLLAPSE_OFF && row < state->collapse.count)
+        return state->collapse.starts[row];
+    return row;
+}
+
+/* Returns the diff row showing line of the first file. Rows are aligned
+ * until they reach the line. The lines of the first file appear in order, so
+ * the row is binary searched, skipping back over rows of inserted lines */
+static unsigned int diff_line_row(fv_state *state, unsigned int line)
+{
+    fv_diff *d = &state->diff;
+    unsigned int lo = 0;
+    unsigned int hi = 0;
+    while(!d->complete && d->a_done <= line) {
+        if (diff_extend(d, &state->f, &state->f2, d->count + line + 1 - d->a_done) == -1)
+            quit(state, "Failed to diff files", EXIT_FAILURE, 1);
+    }
+    /* first row at or after which a line >= 'line' of the first file is shown */
+    hi = d->count;
+    while(lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        long r = mid;
+        while(r >= 0 && d->rows[r].a == DIFF_NONE)
+            r--;
+        if (r >= 0 && d->rows[r].a >= (int)line)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+/* returns the pane receiving input */
+static fv_pane *active_pane(fv_state *state)
+{
+    return &state->panes.nodes[state->panes.active];
+}
+
+/* adjusts voffset and hoffset to scroll file in the active pane */
 static void scroll(fv_state *state, int n, enum scroll_dir dir)
 {
     int max_voffset;
+    unsigned int line_count;
+    unsigned int rows = active_pane(state)->rows;
+    unsigned int cols = active_pane(state)->cols;
+    /* the header row of a table takes a row of the pane */
+    if (state->table_mode && rows > 1)
+        rows--;
     switch (dir) {
         case SCR_UP:
-            if (state->f.line_count <= state->trows)
+            if (row_count(state, 0) <= rows)
                 return ;
             if (state->voffset < n)
                 state->voffset = 0;
@@ -94,9 +196,10 @@ static void scroll(fv_state *state, int n, enum scroll_dir dir)
             return ;
 
         case SCR_DOWN:
-            if (state->f.line_count <= state->trows)
+            line_count = row_count(state, state->voffset + n + rows);
+            if (line_count <= rows)
                 return ;
-            max_voffset = state->f.line_count - state->trows + 3;
+            max_voffset = line_count - rows;
             if (state->voffset + n > max_voffset)
                 state->voffset = max_voffset;
             else
@@ -104,7 +207,8 @@ static void scroll(fv_state *state, int n, enum scroll_dir dir)
             return ;
 
         case SCR_LEFT:
-            if (state->f.max_linelen <= state->tcols - state->f.linenum_digs - 2)
+            /* tables scroll by column */
+            if (state->table_mode == 0 && state->f.max_linelen <= cols - state->f.linenum_digs - 2)
                 return ;
             if (state->hoffset < n)
                 state->hoffset = 0;
@@ -113,7 +217,16 @@ static void scroll(fv_state *state, int n, enum scroll_dir dir)
             return ;
 
         case SCR_RIGHT:
-            if (state->f.max_linelen <= state->tcols - state->f.linenum_digs - 2)
+            if (state->table_mode) {
+                /* tables scroll by column. Keep the last column on screen */
+                unsigned int last_col = state->table.ncols ? state->table.ncols - 1 : 0;
+                if (state->hoffset + n > last_col)
+                    state->hoffset = last_col;
+                else
+                    state->hoffset += n;
+                return ;
+            }
+            if (state->f.max_linelen <= cols - state->f.linenum_digs - 2)
                 return  ;
             if (state->hoffset + n > state->f.max_linelen)
                 state->hoffset = state->f.max_linelen;
@@ -123,6 +236,106 @@ static void scroll(fv_state *state, int n, enum scroll_dir dir)
     }
 }
 
+/* scrolls to row or as close as possible */
+static void goto_row(fv_state *state, unsigned int row)
+{
+    state->voffset = 0;
+    scroll(state, row, SCR_DOWN);
+}
+
+/* scrolls to the row showing line number (0 based) line */
+static void goto_line(fv_state *state, unsigned int line)
+{
+    if (state->diff_mode)
+        goto_row(state, diff_line_row(state, line));
+    else if (state->collapse.mode != COLLAPSE_OFF)
+        goto_row(state, collapse_row(&state->collapse, line));
+    else
+        goto_row(state, line);
+}
+
+/* switches collapsing to mode, or off if it is already in mode. The top
+ * line of every pane stays on screen */
+static void toggle_collapse(fv_state *state, enum collapse_mode mode)
+{
+    fv_panes *panes = &state->panes;
+    unsigned int line = row_line(state, state->voffset);
+    int n = 0;
+    if (state->diff_mode || state->f.hex) {
+        state->message = "Only text files can be collapsed";
+        return ;
+    }
+    if (state->collapse.mode == mode)
+        mode = COLLAPSE_OFF;
+    /* offsets of the other panes are rows too. Keep their lines until the
+     * new rows are built */
+    for(n = next_leaf(panes, -1); n != -1; n = next_leaf(panes, n))
+        panes->nodes[n].voffset = row_line(state, panes->nodes[n].voffset);
+    if (set_collapse(&state->collapse, &state->f, mode) == -1)
+        quit(state, "Failed to collapse lines", EXIT_FAILURE, 1);
+    for(n = next_leaf(panes, -1); n != -1; n = next_leaf(panes, n)) {
+        if (mode != COLLAPSE_OFF)
+            panes->nodes[n].voffset = collapse_row(&state->collapse, panes->nodes[n].voffset);
+    }
+    goto_line(state, line);
+}
+
+/* handles the key after CTRL-W. s and v split the active pane into two
+ * above one another or side by side, w moves to the next pane and q closes
+ * the active pane */
+static void handle_pane_key(int key, fv_state *state)
+{
+    fv_panes *panes = &state->panes;
+    /* splitting and closing start from the offsets being scrolled */
+    active_pane(state)->voffset = state->voffset;
+    active_pane(state)->hoffset = state->hoffset;
+    switch (key) {
+        case 's':
+        case 'v':
+            if (split_pane(panes, key == 's' ? SPLIT_ROWS : SPLIT_COLS) == -1)
+                state->message = "No room to split the pane";
+            break;
+
+        case 'w':
+        case CTRL_W:
+            next_pane(panes);
+            break;
+
+        case 'q':
+            if (close_pane(panes) == -1)
+                state->message = "Can not close the last pane. Press q to quit";
+            break;
+
+        default:
+            return ;
+    }
+    state->voffset = active_pane(state)->voffset;
+    state->hoffset = active_pane(state)->hoffset;
+}
+
+/* scrolls to the match of the current pattern at or after 'from' (before
+ * 'from' if forward is 0) */
+static void goto_match(fv_state *state, long from, int forward)
+{
+    int line = -1;
+    if (from >= 0 && from < state->f.line_count)
+        line = find_match(&state->search, &state->f, from, forward);
+    if (line == -1) {
+        state->message = "Pattern not found";
+        return ;
+    }
+    state->search.current = line;
+    /* skip the rest of a folded run, so n and N do not stop on it again */
+    if (state->collapse.mode != COLLAPSE_OFF) {
+        unsigned int row = collapse_row(&state->collapse, line);
+        if (forward)
+            state->search.current = state->collapse.starts[row + 1] - 1;
+        else
+            state->search.current = state->collapse.starts[row];
+    }
+    goto_line(state, line);
+}
+
 /* handles basic input like movement keys (h, j, k, l, g, G) and quit */
 static void handle_basic_input(int key, fv_state *state)
 {
@@ -150,12 +363,15 @@ static void handle_basic_input(int key, fv_state *state)
 
         case 'G':
             /* scroll to bottom */
-            state->voffset = state->f.line_count - state->trows + 3;
+            goto_row(state, row_count(state, UINT_MAX));
             return ;
 
         case '$':
             /* scroll to end of the largest line */
-            state->hoffset = state->f.max_linelen - state->tcols;
+            if (state->table_mode)
+                scroll(state, state->table.ncols, SCR_RIGHT);
+            else
+                state->hoffset = state->f.max_linelen > active_pane(state)->cols ? state->f.max_linelen - active_pane(state)->cols : 0;
             return ;
 
         case '^':
@@ -163,6 +379,49 @@ static void handle_basic_input(int key, fv_state *state)
             state->hoffset = 0;
             return ;
 
+        case 'c':
+            /* fold runs of identical lines */
+            toggle_collapse(state, COLLAPSE_EXACT);
+            return ;
+
+        case 'C':
+            /* fold runs of lines that differ only in numbers and ids */
+            toggle_collapse(state, COLLAPSE_MASKED);
+            return ;
+
+        case '/':
+            /* start a search prompt. Matches are searched from the current top line */
+            state->search.origin = row_line(state, state->voffset);
+            state->prompt[state->prompt_idx++] = key;
+            return ;
+
+        case 't':
+        case ':':
+            /* start a timestamp or export prompt */
+            state->prompt[state->prompt_idx++] = key;
+            return ;
+
+        case 'n':
+            /* next match */
+            if (state->search.current == -1)
+                goto_match(state, row_line(state, state->voffset), 1);
+            else
+                goto_match(state, state->search.current + 1, 1);
+            return ;
+
+        case 'N':
+            /* previous match */
+            if (state->search.current == -1)
+                goto_match(state, (long)row_line(state, state->voffset) - 1, 0);
+            else
+                goto_match(state, state->search.current - 1, 0);
+            return ;
+
+        case CTRL_W:
+            /* the next key is a pane command */
+            state->panes.pending = 1;
+            return ;
+
         case 'q':
             quit(state, NULL, EXIT_SUCCESS, 1);
     }
@@ -185,9 +444,7 @@ static void handle_numeric_input(int key, fv_state *state)
         case '\r':
         case '\n':
             /* goto the nth line */
-            state->voffset = 0;
-            if (n != 0)
-                scroll(state, n-1, SCR_DOWN);
+            goto_line(state, n != 0 ? n - 1 : 0);
             break;
 
         case 'h':
@@ -201,17 +458,131 @@ static void handle_numeric_input(int key, fv_state *state)
         case 'k':
             scroll(state, n, SCR_UP);
             break;
+
+        case 'l':
+            scroll(state, n, SCR_RIGHT);
+            break;
     }
     clear_prompt(state);
 }
 
-/* Obtains user input via read_key() and modifies the state of fv struct */
-void process_input(fv_state *state)
+/* searches for the pattern typed after '/' starting from the top line when
+ * the prompt was opened. An empty pattern repeats the last search */
+static void search_prompt(fv_state *state)
+{
+    if (state->prompt_idx > 1)
+        set_pattern(&state->search, state->prompt + 1, state->prompt_idx - 1);
+    clear_prompt(state);
+    isearch_end(&state->search);
+    goto_match(state, state->search.origin, 1);
+}
+
+/* Called after every change to the search prompt. Scrolls to the first line
+ * at or after the origin matching what has been typed so far, or back to the
+ * origin if there is none. Levels are kept one per character typed, so only
+ * the lines matching the shorter pattern are checked again */
+static void isearch_update(fv_state *state)
+{
+    fv_search *s = &state->search;
+    unsigned int len = state->prompt_idx - 1;
+    int line;
+    while(s->depth > len)
+        isearch_pop(s);
+    if (s->depth + 1 == len)
+        isearch_push(s, &state->f, state->prompt + 1, len);
+    line = s->depth == len ? isearch_first(s, &state->f, state->prompt + 1, len, s->origin) : -1;
+    goto_line(state, line == -1 ? s->origin : line);
+}
+
+/* scrolls to the first line at or after the timestamp typed after 't' */
+static void timestamp_prompt(fv_state *state)
 {
-    int key = read_key();
+    int line = 0;
+    int ret = find_timestamp(&state->f, state->prompt + 1, state->prompt_idx - 1, &line);
+    clear_prompt(state);
+    switch (ret) {
+        case 0:
+            goto_line(state, line);
+            return ;
+
+        case -1:
+            state->message = "No timestamps found in file";
+            return ;
+
+        case -2:
+            state->message = "Invalid timestamp";
+            return ;
+
+        default:
+            state->message = "No lines at or after timestamp";
+            return ;
+    }
+}
+
+/* ends an incremental search without searching and scrolls back to where
+ * the search started */
+static void cancel_search(fv_state *state)
+{
+    if (state->search.levels == NULL)
+        return ;
+    isearch_end(&state->search);
+    goto_line(state, state->search.origin);
+}
+
+/* exports the line range typed after ':' in the background */
+static void export_prompt(fv_state *state)
+{
+    if (start_export(&state->export, &state->f, state->prompt + 1, state->prompt_idx - 1) == -1)
+        state->message = state->export.status;
+    clear_prompt(state);
+}
+
+/* handles prompts which take a line of text. These are '/' (search),
+ * 't' (jump to timestamp) and ':' (export) */
+static void handle_text_input(int key, fv_state *state)
+{
+    switch (key) {
+        case '\r':
+        case '\n':
+            if (state->prompt[0] == '/')
+                search_prompt(state);
+            else if (state->prompt[0] == 't')
+                timestamp_prompt(state);
+            else
+                export_prompt(state);
+            return ;
+
+        case 127:
+        case '\b':
+            /* backspace. Removing the first character cancels the prompt */
+            state->prompt[--state->prompt_idx] = '\0';
+            if (state->prompt[0] == '/')
+                isearch_update(state);
+            else if (state->prompt_idx == 0)
+                cancel_search(state);
+            return ;
+    }
+    /* prompt is tcols wide. Leave space for the cursor */
+    if (state->prompt_idx < state->tcols - 1) {
+        state->prompt[state->prompt_idx++] = key;
+        if (state->prompt[0] == '/')
+            isearch_update(state);
+    }
+}
+
+/* modifies the state of fv struct based on key */
+static void handle_key(int key, fv_state *state)
+{
+    if (state->panes.pending) {
+        state->panes.pending = 0;
+        handle_pane_key(key, state);
+        return ;
+    }
 
     /* if ESC is pressed, clear prompt */
     if (key == '\x1b') {
+        if (state->prompt[0] == '/')
+            cancel_search(state);
         clear_prompt(state);
         return ;
     }
@@ -229,9 +600,31 @@ void process_input(fv_state *state)
     /* if prompt is not empty */
     if (IS_NUM(state->prompt[0])) {
         handle_numeric_input(key, state);
+    } else if (state->prompt[0] == '/' || state->prompt[0] == 't' || state->prompt[0] == ':') {
+        handle_text_input(key, state);
     } else {
         /* invalid input */
         clear_prompt(state);
     }
     return ;
 }
+
+/* Obtains user input via read_key() and modifies the state of fv struct */
+void process_input(fv_state *state)
+{
+    unsigned int old_voffset = state->voffset;
+    int old_pane = state->panes.active;
+    int key = read_key(state);
+    if (key == KEY_NONE)
+        return ;
+    state->message = NULL;
+    handle_key(key, state);
+    /* Read in the part of the file expected to be shown next. Moving to
+     * another pane is not a jump and must not switch the mapping to random
+     * access. The scroll direction of the old pane does not carry over */
+    if (state->panes.active != old_pane) {
+        state->readahead.velocity = 0;
+        return ;
+    }
+    prefetch(&state->readahead, &state->f, row_line(state, old_voffset), row_line(state, state->voffset), active_pane(state)->rows);
+}
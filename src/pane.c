@@ -0,0 +1,182 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "pane.h"
+
+/* starts with a single pane covering the screen. The area is set by the
+ * first call to layout_panes() */
+void init_panes(fv_panes *p)
+{
+    memset(p, 0, sizeof(fv_panes));
+    p->nodes[0].used = 1;
+    p->nodes[0].split = SPLIT_NONE;
+    p->nodes[0].parent = -1;
+    p->count = 1;
+    p->active = 0;
+}
+
+/* gives node the area at (top, left) and divides it between its children.
+ * Every pane in the area has to be drawn again */
+static void layout_node(fv_panes *p, int n, unsigned int top, unsigned int left, unsigned int rows, unsigned int cols)
+{
+    fv_pane *node = &p->nodes[n];
+    node->top = top;
+    node->left = left;
+    node->rows = rows;
+    node->cols = cols;
+    node->drawn = 0;
+    if (node->split == SPLIT_ROWS) {
+        unsigned int first = rows > 1 ? (rows - 1) / 2 : 0;
+        unsigned int second = rows > first + 1 ? rows - first - 1 : 0;
+        layout_node(p, node->child[0], top, left, first, cols);
+        layout_node(p, node->child[1], top + first + 1, left, second, cols);
+    } else if (node->split == SPLIT_COLS) {
+        unsigned int first = cols > 1 ? (cols - 1) / 2 : 0;
+        unsigned int second = cols > first + 1 ? cols - first - 1 : 0;
+        layout_node(p, node->child[0], top, left, rows, first);
+        layout_node(p, node->child[1], top, left + first + 1, rows, second);
+    }
+    p->separators_drawn = 0;
+}
+
+/* lays out the panes in an area of rows x cols at the top left of the screen */
+void layout_panes(fv_panes *p, unsigned int rows, unsigned int cols)
+{
+    p->rows = rows;
+    p->cols = cols;
+    layout_node(p, 0, 0, 0, rows, cols);
+}
+
+/* returns the index of an unused node */
+static int alloc_node(fv_panes *p)
+{
+    int n = 0;
+    for(n = 0; n < 2 * MAX_PANES - 1; n++) {
+        if (!p->nodes[n].used) {
+            p->nodes[n].used = 1;
+            return n;
+        }
+    }
+    return -1;
+}
+
+/* Splits the active pane in two. Both halves start at the offsets of the
+ * active pane, and the second one (below or to the right) becomes active.
+ * Returns 0 on success and -1 if there is no room for another pane */
+int split_pane(fv_panes *p, enum split_dir split)
+{
+    fv_pane *pane = &p->nodes[p->active];
+    if (p->count == MAX_PANES)
+        return -1;
+    if (split == SPLIT_ROWS && pane->rows < 2 * MIN_PANE_ROWS + 1)
+        return -1;
+    if (split == SPLIT_COLS && pane->cols < 2 * MIN_PANE_COLS + 1)
+        return -1;
+    int a = alloc_node(p);
+    int b = alloc_node(p);
+    p->nodes[a] = *pane;
+    p->nodes[b] = *pane;
+    p->nodes[a].parent = p->active;
+    p->nodes[b].parent = p->active;
+    pane->split = split;
+    pane->child[0] = a;
+    pane->child[1] = b;
+    layout_node(p, p->active, pane->top, pane->left, pane->rows, pane->cols);
+    p->active = b;
+    p->count++;
+    return 0;
+}
+
+/* returns the first pane in the area of node n */
+static int first_leaf(fv_panes *p, int n)
+{
+    while(p->nodes[n].split != SPLIT_NONE)
+        n = p->nodes[n].child[0];
+    return n;
+}
+
+/* Closes the active pane. The pane it was split from takes its area and the
+ * first pane in that area becomes active.
+ * Returns 0 on success and -1 if it is the last pane */
+int close_pane(fv_panes *p)
+{
+    if (p->count == 1)
+        return -1;
+    int leaf = p->active;
+    int parent = p->nodes[leaf].parent;
+    fv_pane *node = &p->nodes[parent];
+    int sibling = node->child[0] == leaf ? node->child[1] : node->child[0];
+    unsigned int top = node->top, left = node->left, rows = node->rows, cols = node->cols;
+    int grandparent = node->parent;
+    /* the sibling moves into the parent's node, so the root stays at 0 */
+    *node = p->nodes[sibling];
+    node->parent = grandparent;
+    if (node->split != SPLIT_NONE) {
+        p->nodes[node->child[0]].parent = parent;
+        p->nodes[node->child[1]].parent = parent;
+    }
+    p->nodes[leaf].used = 0;
+    p->nodes[sibling].used = 0;
+    layout_node(p, parent, top, left, rows, cols);
+    p->active = first_leaf(p, parent);
+    p->count--;
+    return 0;
+}
+
+/* Returns the pane after node n from left to right and top to bottom, or the
+ * first pane if n is -1. Returns -1 after the last pane */
+int next_leaf(fv_panes *p, int n)
+{
+    if (n == -1)
+        return first_leaf(p, 0);
+    while(p->nodes[n].parent != -1) {
+        int parent = p->nodes[n].parent;
+        if (p->nodes[parent].child[0] == n)
+            return first_leaf(p, p->nodes[parent].child[1]);
+        n = parent;
+    }
+    return -1;
+}
+
+/* makes the next pane active, wrapping around after the last one */
+void next_pane(fv_panes *p)
+{
+    p->active = next_leaf(p, p->active);
+    if (p->active == -1)
+        p->active = next_leaf(p, -1);
+}
+
+/* returns the position (1 based) of the active pane in the order of next_leaf() */
+unsigned int pane_number(fv_panes *p)
+{
+    unsigned int k = 1;
+    int n = next_leaf(p, -1);
+    while(n != p->active) {
+        n = next_leaf(p, n);
+        k++;
+    }
+    return k;
+}
@@ -0,0 +1,77 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _PANE_H_
+#define _PANE_H_
+
+#define MAX_PANES 8             /* most panes the screen can be split into */
+#define MIN_PANE_ROWS 2         /* panes are not split below this height */
+#define MIN_PANE_COLS 16        /* panes are not split below this width */
+
+/* how a node of the layout divides its area */
+enum split_dir {
+    SPLIT_NONE,                      /* a leaf. The node is a pane showing the file */
+    SPLIT_ROWS,                      /* children one above the other, with a separator row between */
+    SPLIT_COLS                       /* children side by side, with a separator column between */
+};
+
+/* A node of the layout tree. Leaves are the panes on screen. Every pane has
+ * its own offsets into the file, but all of them share its index and
+ * mapping. The offsets of the active pane are the ones in fv_state */
+struct fv_pane {
+    int used;                        /* 1 if the node is part of the layout */
+    enum split_dir split;            /* SPLIT_NONE for a pane */
+    int parent;                      /* index of the parent node. -1 for the root */
+    int child[2];                    /* children of a split */
+    unsigned int top, left;          /* screen position of the area (0 based) */
+    unsigned int rows, cols;         /* size of the area */
+    unsigned int voffset, hoffset;   /* offsets of a pane */
+
+    /* Compositor variables */
+    int drawn;                       /* 1 if the screen holds the pane as it was last drawn */
+    unsigned int drawn_voffset;      /* offsets the pane was last drawn at */
+    unsigned int drawn_hoffset;
+};
+typedef struct fv_pane fv_pane;
+
+struct fv_panes {
+    fv_pane nodes[2 * MAX_PANES - 1];      /* layout tree. nodes[0] is the root */
+    unsigned int count;              /* number of panes */
+    int active;                      /* node index of the pane receiving input */
+    int pending;                     /* 1 after CTRL-W. The next key is a pane command */
+    unsigned int rows, cols;         /* size of the area laid out. 0 before the first layout */
+    int separators_drawn;            /* 1 if the separators are on screen */
+    unsigned int drawn_view;         /* search generation and collapse mode the panes were drawn with */
+};
+typedef struct fv_panes fv_panes;
+
+void init_panes(fv_panes *p);
+void layout_panes(fv_panes *p, unsigned int rows, unsigned int cols);
+int split_pane(fv_panes *p, enum split_dir split);
+int close_pane(fv_panes *p);
+void next_pane(fv_panes *p);
+int next_leaf(fv_panes *p, int node);
+unsigned int pane_number(fv_panes *p);
+
+#endif /* _PANE_H_ */
@@ -0,0 +1,83 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/* feature test macro for madvise() */
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "prefetch.h"
+
+#define PREFETCH_SCREENS 2      /* number of screens prefetched ahead of the scroll direction */
+#define JUMP_SCREENS 4          /* a move of more than JUMP_SCREENS screens is a jump */
+
+/* advises the kernel about lines [first, last) */
+static void advise_lines(fv_file *f, unsigned int first, unsigned int last, int advice)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    /* madvise() needs a page aligned address */
+    size_t start = line_offset(f, first) / page * page;
+    size_t end = line_offset(f, last);
+    if (end > start)
+        madvise(f->map + start, end - start, advice);
+}
+
+/* Called after every input. Tracks the scroll direction and velocity and
+ * asks the kernel to read in the region shown next, so that scrolling does
+ * not stall on major faults. Big jumps (G, searches, line numbers) switch the
+ * mapping to MADV_RANDOM as there is no access pattern to read ahead for */
+void prefetch(fv_prefetch *p, fv_file *f, unsigned int old_voffset, unsigned int voffset, unsigned int rows)
+{
+    int delta = (int)voffset - (int)old_voffset;
+    unsigned int ahead = 0;
+    if (f->map == NULL || delta == 0)
+        return ;
+
+    if (abs(delta) > JUMP_SCREENS * rows) {
+        if (!p->random)
+            madvise(f->map, f->size, MADV_RANDOM);
+        p->random = 1;
+        p->velocity = 0;
+        /* the jump lands on a cold screen. Read it in one go */
+        advise_lines(f, voffset, voffset + rows, MADV_WILLNEED);
+        return ;
+    }
+    if (p->random)
+        madvise(f->map, f->size, MADV_NORMAL);
+    p->random = 0;
+    p->velocity = (p->velocity + delta) / 2;
+    if (p->velocity == 0)
+        p->velocity = delta > 0 ? 1 : -1;
+
+    /* prefetch more when scrolling fast */
+    ahead = PREFETCH_SCREENS * rows;
+    if (abs(p->velocity) > rows)
+        ahead = PREFETCH_SCREENS * abs(p->velocity);
+    if (p->velocity > 0)
+        advise_lines(f, voffset + rows, voffset + rows + ahead, MADV_WILLNEED);
+    else
+        advise_lines(f, voffset > ahead ? voffset - ahead : 0, voffset, MADV_WILLNEED);
+}
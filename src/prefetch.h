@@ -0,0 +1,39 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+#include "fv_file.h"
+
+/* scroll tracking used to prefetch the part of the file shown next */
+struct fv_prefetch {
+    int velocity;                    /* smoothed rows moved per input. negative when scrolling up */
+    int random;                      /* 1 if the mapping is advised MADV_RANDOM after a big jump */
+};
+typedef struct fv_prefetch fv_prefetch;
+
+void prefetch(fv_prefetch *p, fv_file *f, unsigned int old_voffset, unsigned int voffset, unsigned int rows);
+
+#endif /* _PREFETCH_H_ */
@@ -0,0 +1,275 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/* feature test macro for memmem() */
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "search.h"
+
+/* replaces the current pattern. Bumping the generation invalidates every
+ * entry in the match cache without having to touch them */
+void set_pattern(fv_search *s, const char *pattern, size_t len)
+{
+    char *newmem = realloc(s->pattern, len + 1);
+    if (newmem == NULL) {
+        free(s->pattern);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(newmem, pattern, len);
+    newmem[len] = '\0';
+    s->pattern = newmem;
+    s->len = len;
+    s->generation++;
+}
+
+/* returns 1 if the current pattern occurs in row */
+static int row_matches(fv_search *s, frow *row)
+{
+    return memmem(row->line, row->len, s->pattern, s->len) != NULL;
+}
+
+/* fills entry with the start offsets of all non overlapping matches of the
+ * current pattern in the len bytes of line */
+void match_text(fv_search *s, const char *line, size_t len, match_entry *entry)
+{
+    size_t off = 0;
+    const char *hit;
+    entry->count = 0;
+    while(off < len && (hit = memmem(line + off, len - off, s->pattern, s->len)) != NULL) {
+        if (entry->count == entry->cap) {
+            unsigned int newcap = entry->cap ? entry->cap * 2 : 4;
+            size_t *newmem = realloc(entry->starts, sizeof(size_t) * newcap);
+            if (newmem == NULL) {
+                free(entry->starts);
+                exit(EXIT_FAILURE);
+            }
+            entry->starts = newmem;
+            entry->cap = newcap;
+        }
+        entry->starts[entry->count++] = hit - line;
+        off = hit - line + s->len;
+    }
+}
+
+/* returns the matches of the current pattern in line of f from cache */
+static match_entry *cached_matches(fv_search *s, match_entry *cache, fv_file *f, unsigned int line)
+{
+    if (s->pattern == NULL || s->len == 0 || f->hex || line >= f->line_count)
+        return NULL;
+    match_entry *entry = &cache[line % MATCH_CACHE_SIZE];
+    if (entry->generation != s->generation || entry->line != line) {
+        match_text(s, f->contents[line]->line, f->contents[line]->len, entry);
+        entry->line = line;
+        entry->generation = s->generation;
+    }
+    return entry;
+}
+
+/* Returns the matches of the current pattern in line. Lines are matched only
+ * when they are not in the cache, so scrolling by a row matches at most one
+ * new line. Returns NULL if there is no pattern */
+match_entry *line_matches(fv_search *s, fv_file *f, unsigned int line)
+{
+    return cached_matches(s, s->cache, f, line);
+}
+
+/* same as line_matches() for a line of f, the second file of a diff */
+match_entry *diff_matches(fv_search *s, fv_file *f, unsigned int line)
+{
+    return cached_matches(s, s->diff_cache, f, line);
+}
+
+/* Returns the first line at or after 'from' (before 'from' if forward is 0)
+ * containing the current pattern. Returns -1 if there is no such line */
+int find_match(fv_search *s, fv_file *f, unsigned int from, int forward)
+{
+    if (s->pattern == NULL || s->len == 0 || f->hex)
+        return -1;
+    long i = from;
+    while(i >= 0 && i < f->line_count) {
+        if (row_matches(s, f->contents[i]))
+            return i;
+        i += forward ? 1 : -1;
+    }
+    return -1;
+}
+
+/* appends line to level */
+static int level_push(isearch_level *level, unsigned int *cap, unsigned int line)
+{
+    if (level->count == *cap) {
+        unsigned int newcap = *cap ? *cap * 2 : 64;
+        unsigned int *newmem = realloc(level->lines, sizeof(unsigned int) * newcap);
+        if (newmem == NULL)
+            return -1;
+        level->lines = newmem;
+        *cap = newcap;
+    }
+    level->lines[level->count++] = line;
+    return 0;
+}
+
+/* Collects at most max lines containing pattern into level, starting from
+ * line 'from'. level->end is set to the first line not searched. The mapping
+ * is searched in one piece instead of line by line. Matches are found in
+ * file order, so the line holding each one is found by walking the index
+ * forward */
+static int scan_file(fv_file *f, const char *pattern, size_t len, unsigned int from, unsigned int max, isearch_level *level)
+{
+    unsigned int cap = 0;
+    unsigned int line = from;
+    char *pos;
+    char *end = f->map + f->size;
+    char *hit;
+    level->end = f->line_count;
+    if (from >= f->line_count)
+        return 0;
+    pos = f->contents[from]->line;
+    while(pos < end && (hit = memmem(pos, end - pos, pattern, len)) != NULL) {
+        while(line + 1 < f->line_count && f->contents[line + 1]->line <= hit)
+            line++;
+        /* a match running into the line terminator is not a match */
+        if (hit + len <= f->contents[line]->line + f->contents[line]->len) {
+            if (level_push(level, &cap, line) == -1)
+                return -1;
+            if (line + 1 == f->line_count)
+                break;
+            if (level->count == max) {
+                level->end = line + 1;
+                break;
+            }
+            pos = f->contents[line + 1]->line;
+        } else {
+            pos = hit + 1;
+        }
+    }
+    return 0;
+}
+
+/* Adds a level for pattern, which is the pattern of the previous level with
+ * one more character. A longer pattern can only match lines the shorter one
+ * matched, so only the previous level's lines are checked. Patterns shorter
+ * than ISEARCH_MIN_LEN match too many lines to be worth keeping. The first
+ * level kept searches forward from the origin for at most ISEARCH_MAX_LINES
+ * lines, so neither its time nor its memory grows with the file.
+ * Returns 0 on success and -1 on failure */
+int isearch_push(fv_search *s, fv_file *f, const char *pattern, size_t len)
+{
+    isearch_level level = {NULL, 0, 0, 0};
+    unsigned int cap = 0;
+    unsigned int i = 0;
+    if (f->hex || f->map == NULL)
+        return -1;
+    isearch_level *newmem = realloc(s->levels, sizeof(isearch_level) * (s->depth + 1));
+    if (newmem == NULL)
+        return -1;
+    s->levels = newmem;
+    isearch_level *prev = s->depth > 0 ? &s->levels[s->depth - 1] : NULL;
+    if (len < ISEARCH_MIN_LEN) {
+        /* isearch_first() searches for short patterns directly */
+    } else if (prev == NULL || !prev->built) {
+        level.built = 1;
+        if (scan_file(f, pattern, len, s->origin, ISEARCH_MAX_LINES, &level) == -1) {
+            free(level.lines);
+            return -1;
+        }
+    } else {
+        level.built = 1;
+        level.end = prev->end;
+        for(i = 0; i < prev->count; i++) {
+            frow *row = f->contents[prev->lines[i]];
+            if (memmem(row->line, row->len, pattern, len) != NULL && level_push(&level, &cap, prev->lines[i]) == -1) {
+                free(level.lines);
+                return -1;
+            }
+        }
+    }
+    s->levels[s->depth++] = level;
+    return 0;
+}
+
+/* drops the last level. The previous level is the result for the shorter
+ * pattern, so deleting a character never searches again */
+void isearch_pop(fv_search *s)
+{
+    if (s->depth == 0)
+        return ;
+    free(s->levels[--s->depth].lines);
+}
+
+/* Returns the first line at or after 'from', which is the origin or a later
+ * line, matching pattern, the pattern of the last level. Lines past the
+ * ones the level searched are searched until the first match only.
+ * Returns -1 if there is none */
+int isearch_first(fv_search *s, fv_file *f, const char *pattern, size_t len, unsigned int from)
+{
+    isearch_level found = {NULL, 0, 0, 0};
+    int line = -1;
+    if (s->depth == 0)
+        return -1;
+    isearch_level *level = &s->levels[s->depth - 1];
+    if (level->built) {
+        unsigned int lo = 0;
+        unsigned int hi = level->count;
+        while(lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            if (level->lines[mid] < from)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < level->count)
+            return level->lines[lo];
+        if (level->end > from)
+            from = level->end;
+    }
+    if (scan_file(f, pattern, len, from, 1, &found) == 0 && found.count > 0)
+        line = found.lines[0];
+    free(found.lines);
+    return line;
+}
+
+/* frees every level of an incremental search */
+void isearch_end(fv_search *s)
+{
+    while(s->depth > 0)
+        isearch_pop(s);
+    free(s->levels);
+    s->levels = NULL;
+}
+
+/* frees the pattern and the match cache */
+void free_search(fv_search *s)
+{
+    isearch_end(s);
+    int i = 0;
+    for(i = 0; i < MATCH_CACHE_SIZE; i++) {
+        free(s->cache[i].starts);
+        free(s->diff_cache[i].starts);
+    }
+    free(s->pattern);
+}
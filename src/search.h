@@ -0,0 +1,80 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+
+#include "fv_file.h"
+
+#define MATCH_CACHE_SIZE 256    /* number of per-line entries in the match cache */
+#define ISEARCH_MIN_LEN 3       /* shortest pattern an incremental search keeps candidate lines for */
+#define ISEARCH_MAX_LINES 65536 /* most candidate lines kept for the first level */
+
+/* matches of the current pattern in a single line */
+struct match_entry {
+    unsigned int line;               /* line number (0 based) this entry belongs to */
+    unsigned int generation;         /* pattern generation the matches were computed for */
+    size_t *starts;                  /* start offsets of the matches in the line */
+    unsigned int count;              /* number of matches */
+    unsigned int cap;                /* capacity of the starts array */
+};
+typedef struct match_entry match_entry;
+
+/* Lines that can match the pattern typed so far in an incremental search.
+ * Only lines from the origin up to 'end' were searched */
+struct isearch_level {
+    unsigned int *lines;             /* sorted line numbers (0 based) */
+    unsigned int count;              /* number of lines */
+    unsigned int end;                /* first line not searched */
+    int built;                       /* 0 if the pattern was too short to keep lines for */
+};
+typedef struct isearch_level isearch_level;
+
+struct fv_search {
+    char *pattern;                   /* current search pattern. NULL if there is none */
+    size_t len;                      /* strlen() of the pattern */
+    unsigned int generation;         /* incremented every time the pattern changes */
+    int current;                     /* line of the last match jumped to. -1 if there is none */
+    match_entry cache[MATCH_CACHE_SIZE];   /* direct mapped cache indexed by line % MATCH_CACHE_SIZE */
+    match_entry diff_cache[MATCH_CACHE_SIZE];  /* same as cache for the second file of a diff */
+
+    /* Incremental search variables */
+    isearch_level *levels;           /* levels[k] holds the lines matching the first k + 1 characters */
+    unsigned int depth;              /* number of levels */
+    unsigned int origin;             /* top line when the search prompt was opened */
+};
+typedef struct fv_search fv_search;
+
+void set_pattern(fv_search *s, const char *pattern, size_t len);
+void match_text(fv_search *s, const char *line, size_t len, match_entry *entry);
+match_entry *line_matches(fv_search *s, fv_file *f, unsigned int line);
+match_entry *diff_matches(fv_search *s, fv_file *f, unsigned int line);
+int find_match(fv_search *s, fv_file *f, unsigned int from, int forward);
+int isearch_push(fv_search *s, fv_file *f, const char *pattern, size_t len);
+void isearch_pop(fv_search *s);
+int isearch_first(fv_search *s, fv_file *f, const char *pattern, size_t len, unsigned int from);
+void isearch_end(fv_search *s);
+void free_search(fv_search *s);
+
+#endif /* _SEARCH_H_ */
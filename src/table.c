@@ -0,0 +1,179 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "table.h"
+
+#define TABLE_SAMPLE_ROWS 1024      /* maximum number of rows sampled for column widths */
+#define TABLE_MAX_WIDTH 32          /* widest a column can get. Longer fields are truncated */
+#define TABLE_DEFAULT_WIDTH 8       /* width of columns not seen in the sample */
+
+/* delimiters tried by detect_delim() in order of preference */
+static const char delims[] = "\t,;|";
+
+/* returns 1 if filename has a .csv or .tsv extension */
+int is_table_file(const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+    if (ext == NULL)
+        return 0;
+    return strcmp(ext, ".csv") == 0 || strcmp(ext, ".tsv") == 0;
+}
+
+/* appends a field start offset to entry */
+static void push_start(field_entry *entry, size_t start)
+{
+    if (entry->count == entry->cap) {
+        unsigned int newcap = entry->cap ? entry->cap * 2 : 16;
+        size_t *newmem = realloc(entry->starts, sizeof(size_t) * newcap);
+        if (newmem == NULL) {
+            free(entry->starts);
+            exit(EXIT_FAILURE);
+        }
+        entry->starts = newmem;
+        entry->cap = newcap;
+    }
+    entry->starts[entry->count++] = start;
+}
+
+/* fills entry with the field offsets of row. Delimiters inside double quotes
+ * are not field boundaries */
+static void parse_fields(char delim, frow *row, field_entry *entry)
+{
+    size_t i = 0;
+    int quoted = 0;
+    entry->count = 0;
+    push_start(entry, 0);
+    for(i = 0; i < row->len; i++) {
+        if (row->line[i] == '"')
+            quoted = !quoted;
+        else if (row->line[i] == delim && !quoted)
+            push_start(entry, i + 1);
+    }
+    /* sentinel so that the length of field k is starts[k+1] - starts[k] - 1 */
+    push_start(entry, row->len + 1);
+    entry->count--;
+}
+
+/* picks the delimiter occurring most often in the header row */
+static char detect_delim(frow *header)
+{
+    char best = delims[0];
+    size_t best_count = 0;
+    const char *d = delims;
+    for(d = delims; *d; d++) {
+        size_t count = 0;
+        size_t i = 0;
+        for(i = 0; i < header->len; i++) {
+            if (header->line[i] == *d)
+                count++;
+        }
+        if (count > best_count) {
+            best = *d;
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+/* widens the columns of t to fit the fields in entry */
+static int fit_widths(fv_table *t, field_entry *entry)
+{
+    unsigned int k = 0;
+    if (entry->count > t->ncols) {
+        unsigned int *newmem = realloc(t->widths, sizeof(unsigned int) * entry->count);
+        if (newmem == NULL)
+            return -1;
+        t->widths = newmem;
+        memset(t->widths + t->ncols, 0, sizeof(unsigned int) * (entry->count - t->ncols));
+        t->ncols = entry->count;
+    }
+    for(k = 0; k < entry->count; k++) {
+        size_t len = entry->starts[k+1] - entry->starts[k] - 1;
+        if (len > TABLE_MAX_WIDTH)
+            len = TABLE_MAX_WIDTH;
+        if (len > t->widths[k])
+            t->widths[k] = len;
+    }
+    return 0;
+}
+
+/* Detects the delimiter and works out column widths from at most
+ * TABLE_SAMPLE_ROWS rows spread evenly over the file, so large files are
+ * never scanned in full. Returns 0 on success and -1 on failure */
+int init_table(fv_table *t, fv_file *f)
+{
+    field_entry sample = {0};
+    unsigned int step = 1;
+    unsigned int i = 0;
+    if (f->line_count == 0)
+        return 0;
+    t->delim = detect_delim(f->contents[0]);
+    if (f->line_count > TABLE_SAMPLE_ROWS)
+        step = f->line_count / TABLE_SAMPLE_ROWS + (f->line_count % TABLE_SAMPLE_ROWS != 0);
+    for(i = 0; i < f->line_count; i += step) {
+        parse_fields(t->delim, f->contents[i], &sample);
+        if (fit_widths(t, &sample) == -1) {
+            free(sample.starts);
+            return -1;
+        }
+    }
+    free(sample.starts);
+    return 0;
+}
+
+/* Returns the field offsets of line. Rows are parsed only when they are not
+ * in the cache, so scrolling by a row parses at most one new row */
+field_entry *row_fields(fv_table *t, fv_file *f, unsigned int line)
+{
+    field_entry *entry = &t->cache[line % FIELD_CACHE_SIZE];
+    if (!entry->filled || entry->line != line) {
+        parse_fields(t->delim, f->contents[line], entry);
+        entry->line = line;
+        entry->filled = 1;
+    }
+    return entry;
+}
+
+/* returns the display width of column col */
+unsigned int column_width(fv_table *t, unsigned int col)
+{
+    if (col >= t->ncols)
+        return TABLE_DEFAULT_WIDTH;
+    /* empty columns still take up a cell */
+    if (t->widths[col] == 0)
+        return 1;
+    return t->widths[col];
+}
+
+/* frees column widths and the field offset cache */
+void free_table(fv_table *t)
+{
+    int i = 0;
+    for(i = 0; i < FIELD_CACHE_SIZE; i++)
+        free(t->cache[i].starts);
+    free(t->widths);
+}
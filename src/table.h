@@ -0,0 +1,56 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+#include "fv_file.h"
+
+#define FIELD_CACHE_SIZE 256    /* number of per-row entries in the field offset cache */
+
+/* field offsets of a single row */
+struct field_entry {
+    unsigned int line;               /* line number (0 based) this entry belongs to */
+    int filled;                      /* 1 if the entry holds the offsets of 'line' */
+    size_t *starts;                  /* start offsets of the fields. starts[count] is one past the end of the row */
+    unsigned int count;              /* number of fields */
+    unsigned int cap;                /* capacity of the starts array */
+};
+typedef struct field_entry field_entry;
+
+struct fv_table {
+    char delim;                      /* field delimiter */
+    unsigned int ncols;              /* number of columns seen in the sampled rows */
+    unsigned int *widths;            /* column widths worked out from the sampled rows */
+    field_entry cache[FIELD_CACHE_SIZE];   /* direct mapped cache indexed by line % FIELD_CACHE_SIZE */
+};
+typedef struct fv_table fv_table;
+
+int is_table_file(const char *filename);
+int init_table(fv_table *t, fv_file *f);
+field_entry *row_fields(fv_table *t, fv_file *f, unsigned int line);
+unsigned int column_width(fv_table *t, unsigned int col);
+void free_table(fv_table *t);
+
+#endif /* _TABLE_H_ */
@@ -0,0 +1,252 @@
+/*
+   MIT License
+
+   Copyright (c) 2020 Sai Varshith
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "timestamp.h"
+
+#define TS_DETECT_LINES 16      /* number of lines checked to detect the timestamp format */
+
+/* supported timestamp formats */
+enum ts_format {
+    TS_NONE,
+    TS_ISO8601,     /* 2020-06-16T14:32:05 or 2020-06-16 14:32:05 */
+    TS_SYSLOG,      /* Jun 16 14:32:05 */
+    TS_EPOCH        /* 1592317925 */
+};
+
+/* fields of a parsed timestamp */
+struct ts_fields {
+    long long year, month, day, hour, min, sec;
+};
+
+static const char *months[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* parses exactly n digits from s into out. Returns the number of characters
+ * consumed or 0 on failure */
+static size_t parse_digits(const char *s, size_t len, size_t n, long long *out)
+{
+    size_t i = 0;
+    if (len < n)
+        return 0;
+    *out = 0;
+    for(i = 0; i < n; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return 0;
+        *out = 10 * *out + s[i] - '0';
+    }
+    return n;
+}
+
+/* parses HH:MM[:SS]. Returns the number of characters consumed or 0 on failure */
+static size_t parse_time(const char *s, size_t len, struct ts_fields *ts)
+{
+    size_t pos = 0;
+    ts->sec = 0;
+    if (!parse_digits(s, len, 2, &ts->hour) || len < 5 || s[2] != ':' || !parse_digits(s + 3, len - 3, 2, &ts->min))
+        return 0;
+    pos = 5;
+    if (len >= 8 && s[5] == ':' && parse_digits(s + 6, len - 6, 2, &ts->sec))
+        pos = 8;
+    return pos;
+}
+
+/* parses YYYY-MM-DD[(T| )HH:MM[:SS]]. Returns 0 on success and -1 on failure */
+static int parse_iso8601(const char *s, size_t len, struct ts_fields *ts)
+{
+    if (!parse_digits(s, len, 4, &ts->year) || len < 10 || s[4] != '-' || s[7] != '-')
+        return -1;
+    if (!parse_digits(s + 5, len - 5, 2, &ts->month) || !parse_digits(s + 8, len - 8, 2, &ts->day))
+        return -1;
+    ts->hour = ts->min = ts->sec = 0;
+    if (len > 11 && (s[10] == 'T' || s[10] == ' '))
+        parse_time(s + 11, len - 11, ts);
+    return 0;
+}
+
+/* parses Mmm DD HH:MM:SS. Syslog timestamps have no year.
+ * Returns 0 on success and -1 on failure */
+static int parse_syslog(const char *s, size_t len, struct ts_fields *ts)
+{
+    int m = 0;
+    if (len < 12 || s[3] != ' ' || s[6] != ' ')
+        return -1;
+    for(m = 0; m < 12; m++) {
+        if (memcmp(s, months[m], 3) == 0)
+            break;
+    }
+    if (m == 12)
+        return -1;
+    /* days are padded with a space */
+    if (s[4] == ' ') {
+        if (!parse_digits(s + 5, 1, 1, &ts->day))
+            return -1;
+    } else if (!parse_digits(s + 4, 2, 2, &ts->day)) {
+        return -1;
+    }
+    ts->year = 0;
+    ts->month = m + 1;
+    return parse_time(s + 7, len - 7, ts) ? 0 : -1;
+}
+
+/* parses seconds (or milliseconds) since the epoch. At least 9 digits are
+ * required so that ordinary numbers are not mistaken for timestamps */
+static int parse_epoch(const char *s, size_t len, long long *key)
+{
+    size_t i = 0;
+    *key = 0;
+    while(i < len && i < 18 && s[i] >= '0' && s[i] <= '9') {
+        *key = 10 * *key + s[i] - '0';
+        i++;
+    }
+    return i >= 9 ? 0 : -1;
+}
+
+/* maps timestamp fields to a key that sorts in time order */
+static long long ts_key(struct ts_fields *ts)
+{
+    return ((((ts->year * 13 + ts->month) * 32 + ts->day) * 24 + ts->hour) * 60 + ts->min) * 60 + ts->sec;
+}
+
+/* Parses the timestamp at the start of row. Leading spaces and '[' are
+ * skipped. On success, returns 0 and stores the fields in ts and the sort
+ * key in key. Returns -1 if the row has no timestamp in format fmt */
+static int parse_row(enum ts_format fmt, frow *row, struct ts_fields *ts, long long *key)
+{
+    const char *s = row->line;
+    size_t len = row->len;
+    while(len > 0 && (*s == ' ' || *s == '[')) {
+        s++;
+        len--;
+    }
+    switch (fmt) {
+        case TS_ISO8601:
+            if (parse_iso8601(s, len, ts) == -1)
+                return -1;
+            *key = ts_key(ts);
+            return 0;
+
+        case TS_SYSLOG:
+            if (parse_syslog(s, len, ts) == -1)
+                return -1;
+            *key = ts_key(ts);
+            return 0;
+
+        case TS_EPOCH:
+            return parse_epoch(s, len, key);
+
+        default:
+            return -1;
+    }
+}
+
+/* detects the timestamp format from the first lines of the file. The first
+ * timestamp found is stored in first */
+static enum ts_format detect_format(fv_file *f, struct ts_fields *first)
+{
+    enum ts_format fmt = TS_ISO8601;
+    long long key;
+    for(fmt = TS_ISO8601; fmt <= TS_EPOCH; fmt++) {
+        unsigned int i = 0;
+        for(i = 0; i < f->line_count && i < TS_DETECT_LINES; i++) {
+            if (parse_row(fmt, f->contents[i], first, &key) == 0)
+                return fmt;
+        }
+    }
+    return TS_NONE;
+}
+
+/* Converts the user's query to a key in format fmt. A query with only a
+ * time of day (HH:MM[:SS]) takes its date from 'first'.
+ * Returns 0 on success and -1 on failure */
+static int query_key(enum ts_format fmt, const char *query, size_t len, struct ts_fields *first, long long *key)
+{
+    struct ts_fields ts = *first;
+    size_t i = 0;
+    if (fmt == TS_EPOCH) {
+        for(i = 0; i < len; i++) {
+            if (query[i] < '0' || query[i] > '9')
+                return -1;
+        }
+        return parse_epoch(query, len, key);
+    }
+    if (parse_time(query, len, &ts) == len) {
+        *key = ts_key(&ts);
+        return 0;
+    }
+    if (fmt == TS_ISO8601 && parse_iso8601(query, len, &ts) == 0) {
+        *key = ts_key(&ts);
+        return 0;
+    }
+    if (fmt == TS_SYSLOG && parse_syslog(query, len, &ts) == 0) {
+        *key = ts_key(&ts);
+        return 0;
+    }
+    return -1;
+}
+
+/* Finds the first line with a timestamp at or after the time in query. The
+ * log is assumed to be sorted, so the file is binary searched and only a
+ * handful of lines are ever parsed. Lines without a timestamp (eg. stack
+ * traces) belong to the timestamped line above them.
+ * Returns 0 and stores the line in *line on success.
+ * Returns -1 if the file has no timestamps, -2 if the query is invalid and
+ * -3 if every line is older than the query */
+int find_timestamp(fv_file *f, const char *query, size_t len, int *line)
+{
+    struct ts_fields first;
+    struct ts_fields ts;
+    long long target;
+    long long key;
+    if (f->hex)
+        return -1;
+    enum ts_format fmt = detect_format(f, &first);
+    if (fmt == TS_NONE)
+        return -1;
+    if (query_key(fmt, query, len, &first, &target) == -1)
+        return -2;
+    unsigned int lo = 0;
+    unsigned int hi = f->line_count;
+    while(lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        unsigned int i = mid;
+        /* realign to the next line with a timestamp */
+        while(i < hi && parse_row(fmt, f->contents[i], &ts, &key) == -1)
+            i++;
+        if (i == hi || key >= target)
+            hi = mid;
+        else
+            lo = i + 1;
+    }
+    /* lo may be a continuation line of an older entry */
+    while(lo < f->line_count && parse_row(fmt, f->contents[lo], &ts, &key) == -1)
+        lo++;
+    if (lo == f->line_count)
+        return -3;
+    *line = lo;
+    return 0;
+}